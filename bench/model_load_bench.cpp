@@ -0,0 +1,82 @@
+// startup benchmark for the model import path: cold (assimp import + cache write) versus warm (binary mesh cache).
+// no gl context is created, only the cpu side of Model loading is measured.
+//
+// usage: model_load_bench [runs] [model.obj ...]
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/model.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 5;
+    std::vector<std::string> models;
+    if (argc > 1)
+        runs = std::max(1, std::atoi(argv[1]));
+    for (int i = 2; i < argc; i++)
+        models.push_back(argv[i]);
+    if (models.empty()) {
+        models.push_back(FileSystem::getPath("resources/objects/jdm/AE86Trueno.obj"));
+        models.push_back(FileSystem::getPath("resources/objects/lamps/lamps.obj"));
+        models.push_back(FileSystem::getPath("resources/objects/dumpster/dumpster_obj.obj"));
+    }
+
+    std::printf("%-48s %10s %10s %12s %12s %9s\n", "model", "meshes", "vertices", "cold [ms]", "warm [ms]", "speedup");
+    double totalCold = 0.0, totalWarm = 0.0;
+    for (const std::string &path : models) {
+        std::vector<double> cold, warm;
+        std::vector<MeshData> meshes;
+        bool ok = true;
+        for (int run = 0; run < runs && ok; run++) {
+            // cold: no cache on disk, full assimp import followed by writing the cache
+            std::remove(MeshCache::PathFor(path).c_str());
+            auto start = std::chrono::steady_clock::now();
+            ok = Model::Import(path, meshes);
+            cold.push_back(millisecondsSince(start));
+
+            // warm: the cache written above is mapped and copied out
+            bool fromCache = false;
+            start = std::chrono::steady_clock::now();
+            ok = ok && Model::Import(path, meshes, &fromCache);
+            warm.push_back(millisecondsSince(start));
+            if (ok && !fromCache) {
+                std::cout << "warm load of " << path << " did not hit the cache" << std::endl;
+                ok = false;
+            }
+        }
+        if (!ok) {
+            std::printf("%-48s failed to load\n", path.c_str());
+            continue;
+        }
+
+        size_t vertexCount = 0;
+        for (const MeshData &mesh : meshes)
+            vertexCount += mesh.vertices.size();
+        double c = median(cold), w = median(warm);
+        totalCold += c;
+        totalWarm += w;
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        std::printf("%-48s %10zu %10zu %12.2f %12.2f %8.1fx\n", name.c_str(), meshes.size(), vertexCount, c, w, c / w);
+    }
+    if (totalWarm > 0.0)
+        std::printf("%-48s %10s %10s %12.2f %12.2f %8.1fx\n", "total", "", "", totalCold, totalWarm, totalCold / totalWarm);
+    return 0;
+}
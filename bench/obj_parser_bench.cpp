@@ -0,0 +1,92 @@
+// obj parsing benchmark: assimp's importer (with the post processing Model asks for) versus ObjParser on one thread
+// and on a pool. only parsing is measured, no mesh cache, optimization or texture work, and no gl context is created.
+// the assimp column stops at the aiScene, so it leaves out the copy into MeshData that ObjParser already includes.
+//
+// usage: obj_parser_bench [runs] [model.obj ...]
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/model.h>
+#include <learnopengl/obj_parser.h>
+#include <learnopengl/thread_pool.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 5;
+    std::vector<std::string> models;
+    if (argc > 1)
+        runs = std::max(1, std::atoi(argv[1]));
+    for (int i = 2; i < argc; i++)
+        models.push_back(argv[i]);
+    if (models.empty()) {
+        models.push_back(FileSystem::getPath("resources/objects/jdm/AE86Trueno.obj"));
+        models.push_back(FileSystem::getPath("resources/objects/lamps/lamps.obj"));
+        models.push_back(FileSystem::getPath("resources/objects/dumpster/dumpster_obj.obj"));
+    }
+
+    ThreadPool pool;
+    char pooled[32];
+    std::snprintf(pooled, sizeof(pooled), "%u threads [ms]", pool.Size() + 1);
+    std::printf("%-32s %10s %10s %12s %13s %16s %9s\n", "model", "triangles", "vertices", "assimp [ms]", "1 thread [ms]", pooled, "speedup");
+    double totalAssimp = 0.0, totalPooled = 0.0;
+    for (const std::string &path : models) {
+        std::vector<double> assimp, single, parallel;
+        std::vector<MeshData> meshes;
+        bool ok = true;
+        for (int run = 0; run < runs && ok; run++) {
+            auto start = std::chrono::steady_clock::now();
+            {
+                Assimp::Importer importer;
+                const aiScene *scene = importer.ReadFile(path, Model::IMPORT_FLAGS);
+                ok = scene && !(scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE);
+            }
+            assimp.push_back(millisecondsSince(start));
+
+            start = std::chrono::steady_clock::now();
+            ok = ok && ObjParser::Parse(path, meshes);
+            single.push_back(millisecondsSince(start));
+
+            start = std::chrono::steady_clock::now();
+            ok = ok && ObjParser::Parse(path, meshes, &pool);
+            parallel.push_back(millisecondsSince(start));
+        }
+        if (!ok) {
+            std::printf("%-32s failed to load\n", path.c_str());
+            continue;
+        }
+
+        size_t vertexCount = 0, triangleCount = 0;
+        for (const MeshData &mesh : meshes) {
+            vertexCount += mesh.vertices.size();
+            triangleCount += mesh.indices.size() / 3;
+        }
+        double a = median(assimp), s = median(single), p = median(parallel);
+        totalAssimp += a;
+        totalPooled += p;
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        std::printf("%-32s %10zu %10zu %12.2f %13.2f %16.2f %8.1fx\n", name.c_str(), triangleCount, vertexCount, a, s, p, a / p);
+    }
+    if (totalPooled > 0.0)
+        std::printf("%-32s %10s %10s %12.2f %13s %16.2f %8.1fx\n", "total", "", "", totalAssimp, "", totalPooled, totalAssimp / totalPooled);
+    return 0;
+}
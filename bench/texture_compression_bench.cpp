@@ -0,0 +1,160 @@
+// texture compression benchmark: gpu memory, sampling bandwidth, encode time and quality of the uncompressed
+// upload versus BC1/BC3 and BC7 (BC5 for two channel images). no gl context is created, the encoders run on the cpu
+// exactly as they do on a texture cache miss, and quality is measured by decoding the base level again.
+//
+// usage: texture_compression_bench [runs] [image ...]
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/image.h>
+#include <learnopengl/mip_chain.h>
+#include <learnopengl/texture_compression.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static const char *formatName(GLenum format)
+{
+    switch (format) {
+        case GL_COMPRESSED_RED_RGTC1: return "BC4";
+        case GL_COMPRESSED_RG_RGTC2: return "BC5";
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return "BC1";
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return "BC3";
+        case GL_COMPRESSED_RGBA_BPTC_UNORM: return "BC7";
+        default: return "RGBA8";
+    }
+}
+
+// psnr of the base level over the channels the source image has
+static double psnr(const MipLevel &source, int components, const std::vector<unsigned char> &encoded, GLenum format)
+{
+    int blocksX = (source.width + 3) / 4, blocksY = (source.height + 3) / 4;
+    size_t blockBytes = TextureCompression::BlockBytes(format);
+    double squaredError = 0.0;
+    size_t samples = 0;
+    for (int by = 0; by < blocksY; by++)
+        for (int bx = 0; bx < blocksX; bx++) {
+            unsigned char original[64], decoded[64] = {};
+            BCn::FetchBlock(source.pixels.data(), source.width, source.height, components, bx, by, original);
+            const unsigned char *block = &encoded[(size_t(by) * blocksX + bx) * blockBytes];
+            switch (format) {
+                case GL_COMPRESSED_RED_RGTC1: BCn::DecodeBC4(block, 0, decoded); break;
+                case GL_COMPRESSED_RG_RGTC2: BCn::DecodeBC5(block, decoded); break;
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: BCn::DecodeBC1(block, decoded); break;
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: BCn::DecodeBC3(block, decoded); break;
+                default: BCn::DecodeBC7(block, decoded); break;
+            }
+            // texels of partial blocks past the edge are replicas, skip them
+            for (int y = 0; y < 4 && by * 4 + y < source.height; y++)
+                for (int x = 0; x < 4 && bx * 4 + x < source.width; x++)
+                    for (int c = 0; c < components; c++) {
+                        double d = double(original[(y * 4 + x) * 4 + c]) - decoded[(y * 4 + x) * 4 + c];
+                        squaredError += d * d;
+                        samples++;
+                    }
+        }
+    if (squaredError == 0.0)
+        return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 * samples / squaredError);
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 3;
+    std::vector<std::string> images;
+    if (argc > 1)
+        runs = std::max(1, std::atoi(argv[1]));
+    for (int i = 2; i < argc; i++)
+        images.push_back(argv[i]);
+    if (images.empty()) {
+        images.push_back(FileSystem::getPath("resources/textures/wood.png"));
+        images.push_back(FileSystem::getPath("resources/objects/jdm/body.png"));
+        images.push_back(FileSystem::getPath("resources/objects/jdm/rim.png"));
+        images.push_back(FileSystem::getPath("resources/objects/dumpster/dumpsters_Dumpster_Metallic.png"));
+    }
+
+    ThreadPool pool;
+    std::printf("encoding on %u threads, %d runs each\n", pool.Size(), runs);
+    std::printf("%-36s %11s %6s %12s %11s %12s %10s\n", "image", "size", "format", "memory [KB]", "bits/texel",
+                "encode [ms]", "psnr [dB]");
+
+    size_t totalUncompressed = 0, totalBC = 0, totalBC7 = 0;
+    for (const std::string &path : images) {
+        DecodedImage image;
+        if (!image.Load(path)) {
+            std::printf("%-36s failed to load\n", path.c_str());
+            continue;
+        }
+        std::vector<MipLevel> chain = MipChain::Build(image.data, image.width, image.height, image.components);
+        size_t texels = 0;
+        for (const MipLevel &level : chain)
+            texels += size_t(level.width) * level.height;
+
+        std::vector<GLenum> formats;
+        if (image.components == 1)
+            formats.push_back(GL_COMPRESSED_RED_RGTC1);
+        else if (image.components == 2)
+            formats.push_back(GL_COMPRESSED_RG_RGTC2);
+        else {
+            bool alpha = false;
+            for (size_t i = 0; image.components == 4 && i < size_t(image.width) * image.height && !alpha; i++)
+                alpha = image.data[i * 4 + 3] != 255;
+            formats.push_back(alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+            formats.push_back(GL_COMPRESSED_RGBA_BPTC_UNORM);
+        }
+
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        char size[32];
+        std::snprintf(size, sizeof(size), "%dx%dx%d", image.width, image.height, image.components);
+
+        // drivers store RGB8 padded to 32 bits per texel, so that is what the uncompressed upload costs to sample
+        int uncompressedBits = image.components == 3 ? 32 : image.components * 8;
+        size_t uncompressedBytes = texels * uncompressedBits / 8;
+        totalUncompressed += uncompressedBytes;
+        std::printf("%-36s %11s %6s %12zu %11d %12s %10s\n", name.c_str(), size, "RGBA8", uncompressedBytes / 1024,
+                    uncompressedBits, "-", "-");
+
+        for (GLenum format : formats) {
+            std::vector<double> times;
+            KtxTexture texture;
+            for (int run = 0; run < runs; run++) {
+                auto start = std::chrono::steady_clock::now();
+                texture = TextureCompression::Encode(chain, image.components, format, &pool);
+                times.push_back(millisecondsSince(start));
+            }
+            size_t bytes = texture.Bytes();
+            if (format == GL_COMPRESSED_RGBA_BPTC_UNORM)
+                totalBC7 += bytes;
+            else
+                totalBC += bytes;
+            if (formats.size() == 1)
+                totalBC7 += bytes;
+            std::printf("%-36s %11s %6s %12zu %11d %12.1f %10.2f\n", "", "", formatName(format), bytes / 1024,
+                        int(TextureCompression::BlockBytes(format) * 8 / 16), median(times),
+                        psnr(chain[0], image.components, texture.levels[0], format));
+        }
+    }
+
+    // every texel fetched from memory costs bits/texel, so the memory ratio is also the sampling bandwidth ratio
+    if (totalBC > 0 && totalBC7 > 0)
+        std::printf("\ntotal: uncompressed %zu KB, BC1/BC3 %zu KB (%.1fx smaller), BC7 %zu KB (%.1fx smaller)\n",
+                    totalUncompressed / 1024, totalBC / 1024, double(totalUncompressed) / totalBC,
+                    totalBC7 / 1024, double(totalUncompressed) / totalBC7);
+    return 0;
+}
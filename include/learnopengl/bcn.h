@@ -0,0 +1,460 @@
+#ifndef BCN_H
+#define BCN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// cpu block compressors for the BCn formats. every encoder takes one 4x4 block of RGBA8 texels (64 bytes, row
+// major) and writes the compressed block: 8 bytes for BC1/BC4, 16 bytes for BC3/BC5/BC7.
+// BC1/BC3/BC4/BC5 fit endpoints along the principal axis of the block, BC7 only uses mode 6 (one subset, RGBA
+// endpoints with p-bits, 4 bit indices), which covers most content well at a fraction of a full mode search.
+namespace BCn
+{
+    inline int clampByte(int v)
+    {
+        return v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+
+    inline uint16_t pack565(const float c[3])
+    {
+        int r = (int)std::floor(std::min(std::max(c[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+        int g = (int)std::floor(std::min(std::max(c[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+        int b = (int)std::floor(std::min(std::max(c[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    inline void unpack565(uint16_t c, int out[3])
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+    }
+
+    // mean and principal axis of the block colors (first `channels` channels) through power iteration
+    inline void principalAxis(const uint8_t *rgba, int channels, float mean[4], float axis[4])
+    {
+        for(int c = 0; c < 4; c++)
+            mean[c] = axis[c] = 0.0f;
+        for(int i = 0; i < 16; i++)
+            for(int c = 0; c < channels; c++)
+                mean[c] += rgba[i * 4 + c];
+        for(int c = 0; c < channels; c++)
+            mean[c] /= 16.0f;
+
+        float cov[4][4] = {};
+        for(int i = 0; i < 16; i++)
+        {
+            float d[4];
+            for(int c = 0; c < channels; c++)
+                d[c] = rgba[i * 4 + c] - mean[c];
+            for(int a = 0; a < channels; a++)
+                for(int b = 0; b < channels; b++)
+                    cov[a][b] += d[a] * d[b];
+        }
+
+        // start along the largest diagonal entry, a few iterations are plenty for a 3x3/4x4 matrix
+        int largest = 0;
+        for(int c = 1; c < channels; c++)
+            if(cov[c][c] > cov[largest][largest])
+                largest = c;
+        float v[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        v[largest] = 1.0f;
+        for(int iteration = 0; iteration < 8; iteration++)
+        {
+            float w[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for(int a = 0; a < channels; a++)
+                for(int b = 0; b < channels; b++)
+                    w[a] += cov[a][b] * v[b];
+            float len = 0.0f;
+            for(int c = 0; c < channels; c++)
+                len = std::max(len, std::fabs(w[c]));
+            if(len < 1e-6f)
+                break;
+            for(int c = 0; c < channels; c++)
+                v[c] = w[c] / len;
+        }
+        for(int c = 0; c < channels; c++)
+            axis[c] = v[c];
+    }
+
+    // index of the palette entry closest to every texel, with 4 rgb palette entries
+    inline void selectColorIndices(const uint8_t *rgba, const int palette[4][3], uint8_t indices[16])
+    {
+#if defined(__SSE2__)
+        // squared distances to all 4 palette entries for 4 texels at a time, in 16 bit lanes
+        __m128i pal[4];
+        for(int p = 0; p < 4; p++)
+            pal[p] = _mm_set_epi16(0, (short)palette[p][2], (short)palette[p][1], (short)palette[p][0],
+                                   0, (short)palette[p][2], (short)palette[p][1], (short)palette[p][0]);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rgbMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        for(int i = 0; i < 16; i += 2)
+        {
+            __m128i texels = _mm_and_si128(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rgba + i * 4)), zero), rgbMask);
+            int best[2] = {0, 0};
+            int bestDistance[2] = {1 << 30, 1 << 30};
+            for(int p = 0; p < 4; p++)
+            {
+                __m128i d = _mm_sub_epi16(texels, pal[p]);
+                // pairwise multiply-add gives r*r+g*g and b*b+0 per texel in 32 bit lanes
+                __m128i sq = _mm_madd_epi16(d, d);
+                int32_t lanes[4];
+                _mm_storeu_si128((__m128i*)lanes, sq);
+                for(int t = 0; t < 2; t++)
+                {
+                    int distance = lanes[t * 2] + lanes[t * 2 + 1];
+                    if(distance < bestDistance[t])
+                    {
+                        bestDistance[t] = distance;
+                        best[t] = p;
+                    }
+                }
+            }
+            indices[i] = (uint8_t)best[0];
+            indices[i + 1] = (uint8_t)best[1];
+        }
+#else
+        for(int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for(int p = 0; p < 4; p++)
+            {
+                int dr = rgba[i * 4] - palette[p][0], dg = rgba[i * 4 + 1] - palette[p][1], db = rgba[i * 4 + 2] - palette[p][2];
+                int distance = dr * dr + dg * dg + db * db;
+                if(distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices[i] = (uint8_t)best;
+        }
+#endif
+    }
+
+    // BC1 color block, always in 4 color mode (alpha is ignored)
+    inline void EncodeBC1(const uint8_t *rgba, uint8_t *out)
+    {
+        float mean[4], axis[4];
+        principalAxis(rgba, 3, mean, axis);
+
+        float minT = 1e30f, maxT = -1e30f;
+        for(int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for(int c = 0; c < 3; c++)
+                t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        float e0[3], e1[3];
+        for(int c = 0; c < 3; c++)
+        {
+            e0[c] = mean[c] + axis[c] * maxT;
+            e1[c] = mean[c] + axis[c] * minT;
+        }
+        uint16_t c0 = pack565(e0), c1 = pack565(e1);
+
+        uint8_t indices[16] = {};
+        if(c0 == c1)
+        {
+            // flat block, every texel takes color 0
+        }
+        else
+        {
+            // 4 color mode needs c0 > c1
+            if(c0 < c1)
+                std::swap(c0, c1);
+            int palette[4][3];
+            unpack565(c0, palette[0]);
+            unpack565(c1, palette[1]);
+            for(int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+            selectColorIndices(rgba, palette, indices);
+        }
+
+        out[0] = (uint8_t)(c0 & 0xFF);
+        out[1] = (uint8_t)(c0 >> 8);
+        out[2] = (uint8_t)(c1 & 0xFF);
+        out[3] = (uint8_t)(c1 >> 8);
+        for(int row = 0; row < 4; row++)
+            out[4 + row] = (uint8_t)(indices[row * 4] | (indices[row * 4 + 1] << 2) | (indices[row * 4 + 2] << 4) | (indices[row * 4 + 3] << 6));
+    }
+
+    // BC4 block from one channel of the texels, 8 value mode
+    inline void EncodeBC4(const uint8_t *rgba, int channel, uint8_t *out)
+    {
+        int lo = 255, hi = 0;
+        for(int i = 0; i < 16; i++)
+        {
+            lo = std::min(lo, (int)rgba[i * 4 + channel]);
+            hi = std::max(hi, (int)rgba[i * 4 + channel]);
+        }
+        out[0] = (uint8_t)hi;
+        out[1] = (uint8_t)lo;
+        uint64_t bits = 0;
+        if(hi != lo)
+        {
+            // palette order for a0 > a1: a0, a1, then 6 steps from a0 towards a1
+            static const int order[8] = {1, 7, 6, 5, 4, 3, 2, 0};
+            for(int i = 0; i < 16; i++)
+            {
+                int v = rgba[i * 4 + channel];
+                int step = ((v - lo) * 7 + (hi - lo) / 2) / (hi - lo);
+                bits |= uint64_t(order[step]) << (3 * i);
+            }
+        }
+        for(int b = 0; b < 6; b++)
+            out[2 + b] = (uint8_t)(bits >> (8 * b));
+    }
+
+    // BC3: BC4 alpha block followed by a BC1 color block
+    inline void EncodeBC3(const uint8_t *rgba, uint8_t *out)
+    {
+        EncodeBC4(rgba, 3, out);
+        EncodeBC1(rgba, out + 8);
+    }
+
+    // BC5: red and green as two BC4 blocks
+    inline void EncodeBC5(const uint8_t *rgba, uint8_t *out)
+    {
+        EncodeBC4(rgba, 0, out);
+        EncodeBC4(rgba, 1, out + 8);
+    }
+
+    // BC7 mode 6
+    inline void EncodeBC7(const uint8_t *rgba, uint8_t *out)
+    {
+        static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        float mean[4], axis[4];
+        principalAxis(rgba, 4, mean, axis);
+        float minT = 1e30f, maxT = -1e30f;
+        for(int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for(int c = 0; c < 4; c++)
+                t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+
+        // quantize each endpoint to 7 bits + shared p-bit, keeping the p-bit with the lower error
+        int q[2][4], pbit[2];
+        int endpoint[2][4];
+        for(int e = 0; e < 2; e++)
+        {
+            float target[4];
+            for(int c = 0; c < 4; c++)
+                target[c] = std::min(std::max(mean[c] + axis[c] * (e == 0 ? minT : maxT), 0.0f), 255.0f);
+            float bestError = 1e30f;
+            for(int p = 0; p < 2; p++)
+            {
+                float error = 0.0f;
+                int candidate[4];
+                for(int c = 0; c < 4; c++)
+                {
+                    candidate[c] = std::min(127, std::max(0, (int)std::floor((target[c] - p) / 2.0f + 0.5f)));
+                    float d = target[c] - (candidate[c] * 2 + p);
+                    error += d * d;
+                }
+                if(error < bestError)
+                {
+                    bestError = error;
+                    pbit[e] = p;
+                    for(int c = 0; c < 4; c++)
+                        q[e][c] = candidate[c];
+                }
+            }
+            for(int c = 0; c < 4; c++)
+                endpoint[e][c] = q[e][c] * 2 + pbit[e];
+        }
+
+        int palette[16][4];
+        for(int w = 0; w < 16; w++)
+            for(int c = 0; c < 4; c++)
+                palette[w][c] = ((64 - weights[w]) * endpoint[0][c] + weights[w] * endpoint[1][c] + 32) >> 6;
+        int indices[16];
+        for(int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for(int w = 0; w < 16; w++)
+            {
+                int distance = 0;
+                for(int c = 0; c < 4; c++)
+                {
+                    int d = rgba[i * 4 + c] - palette[w][c];
+                    distance += d * d;
+                }
+                if(distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = w;
+                }
+            }
+            indices[i] = best;
+        }
+        // the anchor index is stored with its top bit implied zero, swap the endpoints if it's set
+        if(indices[0] & 8)
+        {
+            for(int c = 0; c < 4; c++)
+                std::swap(q[0][c], q[1][c]);
+            std::swap(pbit[0], pbit[1]);
+            for(int i = 0; i < 16; i++)
+                indices[i] = 15 - indices[i];
+        }
+
+        uint64_t lo = 0, hi = 0;
+        int position = 0;
+        auto put = [&](uint64_t value, int bits) {
+            for(int b = 0; b < bits; b++, position++)
+            {
+                uint64_t bit = (value >> b) & 1;
+                if(position < 64)
+                    lo |= bit << position;
+                else
+                    hi |= bit << (position - 64);
+            }
+        };
+        put(1 << 6, 7);
+        for(int c = 0; c < 4; c++)
+        {
+            put(q[0][c], 7);
+            put(q[1][c], 7);
+        }
+        put(pbit[0], 1);
+        put(pbit[1], 1);
+        put(indices[0], 3);
+        for(int i = 1; i < 16; i++)
+            put(indices[i], 4);
+        for(int b = 0; b < 8; b++)
+        {
+            out[b] = (uint8_t)(lo >> (8 * b));
+            out[8 + b] = (uint8_t)(hi >> (8 * b));
+        }
+    }
+
+    // copies the 4x4 block at (bx, by) of an image with `components` channels into RGBA8, replicating edge texels
+    // for partial blocks. missing channels are filled like gl does on upload: green/blue 0, alpha 255.
+    inline void FetchBlock(const uint8_t *pixels, int width, int height, int components, int bx, int by, uint8_t block[64])
+    {
+        for(int y = 0; y < 4; y++)
+            for(int x = 0; x < 4; x++)
+            {
+                int sx = std::min(bx * 4 + x, width - 1);
+                int sy = std::min(by * 4 + y, height - 1);
+                const uint8_t *src = pixels + (size_t(sy) * width + sx) * components;
+                uint8_t *dst = block + (y * 4 + x) * 4;
+                dst[0] = src[0];
+                dst[1] = components > 1 ? src[1] : 0;
+                dst[2] = components > 2 ? src[2] : 0;
+                dst[3] = components > 3 ? src[3] : 255;
+            }
+    }
+
+    // reference decoders, only used to measure encoder quality; the gpu does the real decoding.
+    // BC1 color blocks inside BC3 always use 4 color mode, standalone ones switch to 3 colors + black if c0 <= c1.
+    inline void DecodeBC1(const uint8_t *in, uint8_t rgba[64], bool fourColorOnly = false)
+    {
+        uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8)), c1 = (uint16_t)(in[2] | (in[3] << 8));
+        int palette[4][3];
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        bool fourColors = fourColorOnly || c0 > c1;
+        for(int c = 0; c < 3; c++)
+        {
+            palette[2][c] = fourColors ? (2 * palette[0][c] + palette[1][c] + 1) / 3 : (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = fourColors ? (palette[0][c] + 2 * palette[1][c] + 1) / 3 : 0;
+        }
+        for(int i = 0; i < 16; i++)
+        {
+            int index = (in[4 + i / 4] >> (2 * (i % 4))) & 3;
+            for(int c = 0; c < 3; c++)
+                rgba[i * 4 + c] = (uint8_t)palette[index][c];
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    inline void DecodeBC4(const uint8_t *in, int channel, uint8_t rgba[64])
+    {
+        int a0 = in[0], a1 = in[1];
+        int palette[8] = {a0, a1};
+        if(a0 > a1)
+            for(int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+        else
+        {
+            for(int i = 1; i < 5; i++)
+                palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t bits = 0;
+        for(int b = 0; b < 6; b++)
+            bits |= uint64_t(in[2 + b]) << (8 * b);
+        for(int i = 0; i < 16; i++)
+            rgba[i * 4 + channel] = (uint8_t)palette[(bits >> (3 * i)) & 7];
+    }
+
+    inline void DecodeBC3(const uint8_t *in, uint8_t rgba[64])
+    {
+        DecodeBC1(in + 8, rgba, true);
+        DecodeBC4(in, 3, rgba);
+    }
+
+    inline void DecodeBC5(const uint8_t *in, uint8_t rgba[64])
+    {
+        DecodeBC4(in, 0, rgba);
+        DecodeBC4(in + 8, 1, rgba);
+        for(int i = 0; i < 16; i++)
+        {
+            rgba[i * 4 + 2] = 0;
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    // mode 6 only, the one mode EncodeBC7 writes; other modes decode to black
+    inline void DecodeBC7(const uint8_t *in, uint8_t rgba[64])
+    {
+        static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+        int position = 0;
+        auto read = [&](int count) {
+            int value = 0;
+            for(int i = 0; i < count; i++, position++)
+                value |= ((in[position / 8] >> (position % 8)) & 1) << i;
+            return value;
+        };
+        std::memset(rgba, 0, 64);
+        if(read(7) != 64)
+            return;
+        int endpoint[2][4];
+        for(int c = 0; c < 4; c++)
+        {
+            endpoint[0][c] = read(7) << 1;
+            endpoint[1][c] = read(7) << 1;
+        }
+        int p0 = read(1), p1 = read(1);
+        for(int c = 0; c < 4; c++)
+        {
+            endpoint[0][c] |= p0;
+            endpoint[1][c] |= p1;
+        }
+        for(int i = 0; i < 16; i++)
+        {
+            int w = weights[read(i == 0 ? 3 : 4)];
+            for(int c = 0; c < 4; c++)
+                rgba[i * 4 + c] = (uint8_t)(((64 - w) * endpoint[0][c] + w * endpoint[1][c] + 32) >> 6);
+        }
+    }
+}
+#endif
@@ -0,0 +1,80 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// fast non-cryptographic 64 bit hash used to key on-disk caches by file content.
+// consumes 8 bytes per step, so hashing a large source file costs roughly one memory pass.
+class ContentHash
+{
+public:
+    static uint64_t Bytes(const void *data, size_t size, uint64_t seed = 0)
+    {
+        const unsigned char *p = static_cast<const unsigned char*>(data);
+        uint64_t h = seed ^ (size * PRIME_1);
+
+        while(size >= 8)
+        {
+            uint64_t k;
+            std::memcpy(&k, p, 8);
+            h ^= mix(k);
+            h = rotl(h, 27) * PRIME_1 + PRIME_4;
+            p += 8;
+            size -= 8;
+        }
+        // tail bytes
+        uint64_t k = 0;
+        for(size_t i = 0; i < size; i++)
+            k |= uint64_t(p[i]) << (8 * i);
+        h ^= mix(k);
+
+        // final avalanche
+        h ^= h >> 33;
+        h *= PRIME_2;
+        h ^= h >> 29;
+        h *= PRIME_3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    static uint64_t String(const std::string &s, uint64_t seed = 0)
+    {
+        return Bytes(s.data(), s.size(), seed);
+    }
+
+    // order dependent combination of two hashes
+    static uint64_t Combine(uint64_t a, uint64_t b)
+    {
+        return rotl(a, 31) * PRIME_1 ^ mix(b);
+    }
+
+    static std::string ToHex(uint64_t h)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(16, '0');
+        for(int i = 15; i >= 0; i--, h >>= 4)
+            out[i] = digits[h & 0xF];
+        return out;
+    }
+
+private:
+    static const uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+    static const uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+    static const uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+    static const uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+
+    static uint64_t rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static uint64_t mix(uint64_t k)
+    {
+        k *= PRIME_2;
+        k = rotl(k, 31);
+        return k * PRIME_1;
+    }
+};
+#endif
@@ -0,0 +1,263 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/vertex_format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// one vertex buffer, one index buffer and one VAO holding the geometry of many meshes, so a whole model draws
+// with a single VAO bind. meshes are added on the cpu (packed into the arena's vertex format, indices relative to
+// the mesh and 16 bit wherever the mesh has at most 65536 vertices) and everything is uploaded at once.
+// draws use glDrawElementsBaseVertex with the Range returned by Add.
+class GeometryArena
+{
+public:
+    struct Range {
+        GLint baseVertex = 0;
+        size_t indexOffset = 0;     // in bytes
+        GLsizei indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        // quantized positions only: model space = offset + stored * scale
+        glm::vec3 positionOffset = glm::vec3(0.0f);
+        glm::vec3 positionScale = glm::vec3(1.0f);
+    };
+
+    explicit GeometryArena(VertexFormat format = VERTEX_FLOAT) : format(format) {}
+
+    ~GeometryArena()
+    {
+        if(VAO)
+        {
+            GLState::DeleteVertexArray(VAO);
+            glDeleteBuffers(1, &VBO);
+            glDeleteBuffers(1, &EBO);
+        }
+    }
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    static unsigned int VertexStride(VertexFormat format)
+    {
+        switch(format)
+        {
+            case VERTEX_COMPACT: return sizeof(CompactVertex);
+            case VERTEX_COMPACT_QUANTIZED: return sizeof(QuantizedVertex);
+            default: return sizeof(Vertex);
+        }
+    }
+
+    VertexFormat Format() const { return format; }
+
+    // appends a mesh to the staging buffers. has to happen before Upload.
+    Range Add(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+    {
+        Range range;
+        range.baseVertex = (GLint)vertexCount;
+        range.indexCount = (GLsizei)indices.size();
+        range.indexType = vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+        if(format == VERTEX_COMPACT)
+            appendCompact(vertices);
+        else if(format == VERTEX_COMPACT_QUANTIZED)
+            appendQuantized(vertices, range);
+        else
+            append(vertexData, vertices.data(), vertices.size() * sizeof(Vertex));
+        vertexCount += vertices.size();
+
+        appendIndices(indices, range);
+        return range;
+    }
+
+    // another index list over the vertices of a mesh already added, e.g. a coarser level of detail. the returned
+    // range draws those indices with the mesh's vertices.
+    Range AddIndices(const Range &mesh, const vector<unsigned int> &indices)
+    {
+        Range range = mesh;
+        range.indexCount = (GLsizei)indices.size();
+        appendIndices(indices, range);
+        return range;
+    }
+
+    // creates the gl buffers from everything added and frees the staging memory
+    void Upload()
+    {
+        if(VAO)
+            return;
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        GLState::BindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
+
+        if(format == VERTEX_FLOAT)
+            floatAttributes();
+        else if(format == VERTEX_COMPACT)
+        {
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, Position));
+            compactAttributes<CompactVertex>();
+        }
+        else
+        {
+            // positions, 16 bit unsigned normalized over the mesh bounds
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, Position));
+            compactAttributes<QuantizedVertex>();
+        }
+        GLState::BindVertexArray(0);
+
+        vertexBytes = vertexData.size();
+        indexBytes = indexData.size();
+        vector<unsigned char>().swap(vertexData);
+        vector<unsigned char>().swap(indexData);
+    }
+
+    bool Uploaded() const { return VAO != 0; }
+    unsigned int VertexArray() const { return VAO; }
+
+    void Bind() const
+    {
+        GLState::BindVertexArray(VAO);
+    }
+
+    static void Draw(const Range &range)
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, range.indexType, (void*)range.indexOffset, range.baseVertex);
+    }
+
+    // gpu memory of the buffers, valid after Upload
+    size_t VertexBytes() const { return vertexBytes; }
+    size_t IndexBytes() const { return indexBytes; }
+
+private:
+    VertexFormat format;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    vector<unsigned char> vertexData;
+    vector<unsigned char> indexData;
+    size_t vertexCount = 0;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+
+    static void append(vector<unsigned char> &buffer, const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    void appendIndices(const vector<unsigned int> &indices, Range &range)
+    {
+        // 32 bit ranges stay 4 byte aligned after 16 bit ones
+        indexData.resize((indexData.size() + 3) & ~size_t(3));
+        range.indexOffset = indexData.size();
+        if(range.indexType == GL_UNSIGNED_SHORT)
+        {
+            vector<uint16_t> narrow(indices.begin(), indices.end());
+            append(indexData, narrow.data(), narrow.size() * sizeof(uint16_t));
+        }
+        else
+            append(indexData, indices.data(), indices.size() * sizeof(unsigned int));
+    }
+
+    void floatAttributes()
+    {
+        // set the vertex attribute pointers
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    }
+
+    template<typename T>
+    void compactAttributes()
+    {
+        // normals, 10-10-10-2 signed normalized
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(T), (void*)offsetof(T, Normal));
+        // texture coords, half floats
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(T), (void*)offsetof(T, TexCoords));
+        // tangent with the bitangent's handedness in w
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(T), (void*)offsetof(T, Tangent));
+        // no bitangent stream, shaders rebuild it from normal and tangent
+        glDisableVertexAttribArray(4);
+    }
+
+    // the attributes both compact layouts share, at the same offsets
+    template<typename T>
+    static void packCompact(const Vertex &vertex, T &packed)
+    {
+        glm::vec3 normal = VertexPacking::SafeNormalize(vertex.Normal);
+        packed.Normal = VertexPacking::PackSnorm1010102(normal, 0.0f);
+        packed.TexCoords[0] = VertexPacking::FloatToHalf(vertex.TexCoords.x);
+        packed.TexCoords[1] = VertexPacking::FloatToHalf(vertex.TexCoords.y);
+        packed.Tangent = VertexPacking::PackSnorm1010102(VertexPacking::SafeNormalize(vertex.Tangent),
+                                                         VertexPacking::Handedness(normal, vertex.Tangent, vertex.Bitangent));
+    }
+
+    void appendCompact(const vector<Vertex> &vertices)
+    {
+        vector<CompactVertex> packed(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++)
+        {
+            packed[i].Position = vertices[i].Position;
+            packCompact(vertices[i], packed[i]);
+        }
+        append(vertexData, packed.data(), packed.size() * sizeof(CompactVertex));
+    }
+
+    void appendQuantized(const vector<Vertex> &vertices, Range &range)
+    {
+        glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+        for(size_t i = 0; i < vertices.size(); i++)
+        {
+            boundsMin = i == 0 ? vertices[i].Position : glm::min(boundsMin, vertices[i].Position);
+            boundsMax = i == 0 ? vertices[i].Position : glm::max(boundsMax, vertices[i].Position);
+        }
+        range.positionOffset = boundsMin;
+        range.positionScale = boundsMax - boundsMin;
+
+        vector<QuantizedVertex> packed(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++)
+        {
+            for(int axis = 0; axis < 3; axis++)
+            {
+                float extent = range.positionScale[axis];
+                float t = extent > 0.0f ? (vertices[i].Position[axis] - boundsMin[axis]) / extent : 0.0f;
+                packed[i].Position[axis] = (uint16_t)std::floor(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f + 0.5f);
+            }
+            packed[i].Position[3] = 0;
+            packCompact(vertices[i], packed[i]);
+        }
+        append(vertexData, packed.data(), packed.size() * sizeof(QuantizedVertex));
+    }
+};
+#endif
@@ -0,0 +1,235 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// the program, VAO, texture and fixed function state the engine sets, shadowed on the cpu so a call that would leave
+// the state as it is never reaches the driver. every such call of the engine goes through here; code changing the
+// state behind its back has to Invalidate it or put back what it found, as the imgui backend does. everything starts
+// out unknown, the first call of each kind is always issued. like gl itself only for the thread owning the context.
+class GLState
+{
+public:
+    struct Calls {
+        size_t issued = 0;
+        size_t skipped = 0;
+    };
+
+    // counted since the last ResetStats
+    struct Stats {
+        Calls programs;
+        Calls vertexArrays;
+        Calls textures;         // binds and active unit changes
+        Calls fixedFunction;    // blend, depth test and cull state
+    };
+
+    // units from here up are not shadowed, binds to them always reach the driver
+    static const unsigned int TRACKED_UNITS = 16;
+
+    static void UseProgram(GLuint program)
+    {
+        State &s = state();
+        if(issue(stats().programs, s.program != program))
+        {
+            s.program = program;
+            glUseProgram(program);
+        }
+    }
+
+    static void BindVertexArray(GLuint vao)
+    {
+        State &s = state();
+        if(issue(stats().vertexArrays, s.vertexArray != vao))
+        {
+            s.vertexArray = vao;
+            glBindVertexArray(vao);
+        }
+    }
+
+    // unit is an index, not GL_TEXTUREi
+    static void ActiveTexture(unsigned int unit)
+    {
+        State &s = state();
+        if(issue(stats().textures, s.activeUnit != unit))
+        {
+            s.activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+    }
+
+    // binds texture to target of the active unit, as glBindTexture does. uploads go through here too, the unit they
+    // bind on is whatever the last draw left active.
+    static void BindTexture(GLenum target, GLuint texture)
+    {
+        GLuint *bound = binding(state().activeUnit, target);
+        if(issue(stats().textures, !bound || *bound != texture))
+        {
+            if(bound)
+                *bound = texture;
+            glBindTexture(target, texture);
+        }
+    }
+
+    // binds texture to target of unit. the unit is only made active when the binding changes, callers can't count
+    // on which unit is active afterwards.
+    static void BindTexture(unsigned int unit, GLenum target, GLuint texture)
+    {
+        GLuint *bound = binding(unit, target);
+        if(bound && *bound == texture)
+        {
+            stats().textures.skipped++;
+            return;
+        }
+        ActiveTexture(unit);
+        BindTexture(target, texture);
+    }
+
+    // GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE are shadowed, any other capability goes straight to the driver
+    static void Enable(GLenum capability) { setCapability(capability, true); }
+    static void Disable(GLenum capability) { setCapability(capability, false); }
+
+    static void BlendFunc(GLenum source, GLenum destination)
+    {
+        State &s = state();
+        if(issue(stats().fixedFunction, s.blendSource != source || s.blendDestination != destination))
+        {
+            s.blendSource = source;
+            s.blendDestination = destination;
+            glBlendFunc(source, destination);
+        }
+    }
+
+    static void DepthFunc(GLenum func)
+    {
+        State &s = state();
+        if(issue(stats().fixedFunction, s.depthFunc != func))
+        {
+            s.depthFunc = func;
+            glDepthFunc(func);
+        }
+    }
+
+    static void CullFace(GLenum mode)
+    {
+        State &s = state();
+        if(issue(stats().fixedFunction, s.cullFace != mode))
+        {
+            s.cullFace = mode;
+            glCullFace(mode);
+        }
+    }
+
+    static void FrontFace(GLenum mode)
+    {
+        State &s = state();
+        if(issue(stats().fixedFunction, s.frontFace != mode))
+        {
+            s.frontFace = mode;
+            glFrontFace(mode);
+        }
+    }
+
+    // deleting a bound object binds 0 in its place, the shadow follows
+    static void DeleteTexture(GLuint texture)
+    {
+        State &s = state();
+        for(unsigned int unit = 0; unit < TRACKED_UNITS; unit++)
+        {
+            if(s.textures2D[unit] == texture)
+                s.textures2D[unit] = 0;
+            if(s.cubemaps[unit] == texture)
+                s.cubemaps[unit] = 0;
+        }
+        glDeleteTextures(1, &texture);
+    }
+
+    static void DeleteVertexArray(GLuint vao)
+    {
+        State &s = state();
+        if(s.vertexArray == vao)
+            s.vertexArray = 0;
+        glDeleteVertexArrays(1, &vao);
+    }
+
+    // forgets everything, the next call of each kind is issued whatever its value
+    static void Invalidate() { state() = State(); }
+
+    static const Stats &GetStats() { return stats(); }
+    static void ResetStats() { stats() = Stats(); }
+
+private:
+    enum : GLuint { UNKNOWN = 0xFFFFFFFFu };
+    enum { CAPABILITY_BLEND, CAPABILITY_DEPTH_TEST, CAPABILITY_CULL_FACE, CAPABILITY_COUNT };
+
+    struct State {
+        GLuint program = UNKNOWN;
+        GLuint vertexArray = UNKNOWN;
+        GLuint activeUnit = UNKNOWN;
+        GLuint textures2D[TRACKED_UNITS];
+        GLuint cubemaps[TRACKED_UNITS];
+        int capabilities[CAPABILITY_COUNT] = {-1, -1, -1};     // -1 unknown, else enabled or not
+        GLenum blendSource = UNKNOWN, blendDestination = UNKNOWN;
+        GLenum depthFunc = UNKNOWN;
+        GLenum cullFace = UNKNOWN, frontFace = UNKNOWN;
+
+        State()
+        {
+            for(unsigned int unit = 0; unit < TRACKED_UNITS; unit++)
+                textures2D[unit] = cubemaps[unit] = UNKNOWN;
+        }
+    };
+
+    static State &state()
+    {
+        static State current;
+        return current;
+    }
+
+    static Stats &stats()
+    {
+        static Stats frame;
+        return frame;
+    }
+
+    // counts the call and tells whether it has to be made
+    static bool issue(Calls &calls, bool changed)
+    {
+        if(changed)
+            calls.issued++;
+        else
+            calls.skipped++;
+        return changed;
+    }
+
+    // the shadowed binding of target on unit, nullptr when it isn't tracked
+    static GLuint *binding(GLuint unit, GLenum target)
+    {
+        if(unit >= TRACKED_UNITS)
+            return nullptr;
+        if(target == GL_TEXTURE_2D)
+            return &state().textures2D[unit];
+        if(target == GL_TEXTURE_CUBE_MAP)
+            return &state().cubemaps[unit];
+        return nullptr;
+    }
+
+    static void setCapability(GLenum capability, bool enabled)
+    {
+        int index = capability == GL_BLEND ? CAPABILITY_BLEND
+                  : capability == GL_DEPTH_TEST ? CAPABILITY_DEPTH_TEST
+                  : capability == GL_CULL_FACE ? CAPABILITY_CULL_FACE : -1;
+        int &current = state().capabilities[index < 0 ? 0 : index];
+        if(issue(stats().fixedFunction, index < 0 || current != (int)enabled))
+        {
+            if(index >= 0)
+                current = (int)enabled;
+            if(enabled)
+                glEnable(capability);
+            else
+                glDisable(capability);
+        }
+    }
+};
+#endif
@@ -0,0 +1,79 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+// pixels decoded by stb_image, owned and freed by this object. decoding touches no gl state, so it is safe on
+// worker threads. stb_image (v2.14) keeps the vertical flip flag global, so it must stay untouched while decodes
+// are in flight; ask Load for a flipped image instead.
+class DecodedImage
+{
+public:
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char *data = nullptr;
+
+    DecodedImage() {}
+
+    ~DecodedImage()
+    {
+        if(data)
+            stbi_image_free(data);
+    }
+
+    DecodedImage(DecodedImage &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    DecodedImage& operator=(DecodedImage &&other) noexcept
+    {
+        if(this != &other)
+        {
+            if(data)
+                stbi_image_free(data);
+            width = other.width;
+            height = other.height;
+            components = other.components;
+            data = other.data;
+            other.data = nullptr;
+        }
+        return *this;
+    }
+
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+
+    bool Valid() const { return data != nullptr; }
+
+    size_t Bytes() const { return size_t(width) * height * components; }
+
+    bool Load(const std::string &path, bool flipVertically = false)
+    {
+        *this = DecodedImage();
+        data = stbi_load(path.c_str(), &width, &height, &components, 0);
+        if(data && flipVertically)
+        {
+            size_t rowBytes = size_t(width) * components;
+            for(int y = 0; y < height / 2; y++)
+                std::swap_ranges(data + y * rowBytes, data + (y + 1) * rowBytes, data + (height - 1 - y) * rowBytes);
+        }
+        return data != nullptr;
+    }
+
+    // size of the decoded pixels without decoding, read from the file header. returns 0 if the file isn't readable.
+    static size_t PeekBytes(const std::string &path)
+    {
+        int w, h, n;
+        if(!stbi_info(path.c_str(), &w, &h, &n))
+            return 0;
+        return size_t(w) * h * n;
+    }
+};
+#endif
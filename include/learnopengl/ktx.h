@@ -0,0 +1,220 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/mapped_file.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+// block compression formats from extensions glad wasn't generated with
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+// a 2D texture with its mip levels, ready to be handed to glTexImage2D / glCompressedTexImage2D level by level.
+// glType and glFormat are 0 for block compressed data, as in the KTX header.
+struct KtxTexture {
+    GLenum glInternalFormat = 0;
+    GLenum glFormat = 0;
+    GLenum glType = 0;
+    int width = 0;
+    int height = 0;
+    vector<vector<unsigned char>> levels;
+    // free form metadata, stored in the KTX key/value section
+    map<string, string> keyValues;
+
+    bool Compressed() const { return glType == 0; }
+
+    bool Valid() const { return width > 0 && height > 0 && !levels.empty(); }
+
+    size_t Bytes() const
+    {
+        size_t bytes = 0;
+        for(const vector<unsigned char> &level : levels)
+            bytes += level.size();
+        return bytes;
+    }
+};
+
+// reader/writer for the subset of KTX 1.1 we produce: single 2D images (no arrays, no cube faces) with any number
+// of mip levels, little endian.
+class Ktx
+{
+public:
+    static bool Write(const string &path, const KtxTexture &texture)
+    {
+        string kv;
+        for(const auto &entry : texture.keyValues)
+        {
+            string pair = entry.first + '\0' + entry.second + '\0';
+            uint32_t size = (uint32_t)pair.size();
+            kv.append(reinterpret_cast<const char*>(&size), 4);
+            kv += pair;
+            kv.append(padding(pair.size()), '\0');
+        }
+
+        Header header;
+        memcpy(header.identifier, identifier(), 12);
+        header.endianness = 0x04030201;
+        header.glType = texture.glType;
+        header.glTypeSize = 1;
+        header.glFormat = texture.glFormat;
+        header.glInternalFormat = texture.glInternalFormat;
+        header.glBaseInternalFormat = baseFormat(texture);
+        header.pixelWidth = (uint32_t)texture.width;
+        header.pixelHeight = (uint32_t)texture.height;
+        header.pixelDepth = 0;
+        header.numberOfArrayElements = 0;
+        header.numberOfFaces = 1;
+        header.numberOfMipmapLevels = (uint32_t)texture.levels.size();
+        header.bytesOfKeyValueData = (uint32_t)kv.size();
+
+        // written under a temporary name and renamed, so readers never see a partial file
+        string tmpPath = path + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            if(!out)
+                return false;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            out.write(kv.data(), kv.size());
+            for(const vector<unsigned char> &level : texture.levels)
+            {
+                uint32_t imageSize = (uint32_t)level.size();
+                out.write(reinterpret_cast<const char*>(&imageSize), 4);
+                out.write(reinterpret_cast<const char*>(level.data()), level.size());
+                static const char zeros[4] = {};
+                out.write(zeros, padding(level.size()));
+            }
+            if(!out)
+            {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+        }
+        if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // metadataOnly stops after the header and key/value data, levels stays empty
+    static bool Read(const string &path, KtxTexture &texture, bool metadataOnly = false)
+    {
+        MappedFile file(path);
+        if(!file.IsOpen() || file.Size() < sizeof(Header))
+            return false;
+        Header header;
+        memcpy(&header, file.Data(), sizeof(Header));
+        if(memcmp(header.identifier, identifier(), 12) != 0 || header.endianness != 0x04030201 ||
+           header.numberOfFaces != 1 || header.numberOfArrayElements != 0 || header.pixelDepth != 0 ||
+           header.numberOfMipmapLevels == 0)
+            return false;
+
+        KtxTexture result;
+        result.glInternalFormat = header.glInternalFormat;
+        result.glFormat = header.glFormat;
+        result.glType = header.glType;
+        result.width = (int)header.pixelWidth;
+        result.height = (int)header.pixelHeight;
+
+        size_t offset = sizeof(Header);
+        size_t kvEnd = offset + header.bytesOfKeyValueData;
+        if(kvEnd > file.Size())
+            return false;
+        const char *data = reinterpret_cast<const char*>(file.Data());
+        while(offset + 4 <= kvEnd)
+        {
+            uint32_t size;
+            memcpy(&size, data + offset, 4);
+            offset += 4;
+            if(offset + size > kvEnd)
+                return false;
+            string pair(data + offset, size);
+            size_t split = pair.find('\0');
+            if(split != string::npos)
+            {
+                string value = pair.substr(split + 1);
+                if(!value.empty() && value.back() == '\0')
+                    value.pop_back();
+                result.keyValues[pair.substr(0, split)] = value;
+            }
+            offset += size + padding(size);
+        }
+        offset = kvEnd;
+
+        for(uint32_t level = 0; level < header.numberOfMipmapLevels && !metadataOnly; level++)
+        {
+            if(offset + 4 > file.Size())
+                return false;
+            uint32_t imageSize;
+            memcpy(&imageSize, data + offset, 4);
+            offset += 4;
+            if(offset + imageSize > file.Size())
+                return false;
+            result.levels.emplace_back(file.Data() + offset, file.Data() + offset + imageSize);
+            offset += imageSize + padding(imageSize);
+        }
+        texture = std::move(result);
+        return true;
+    }
+
+private:
+    static const unsigned char *identifier()
+    {
+        static const unsigned char id[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+        return id;
+    }
+
+    struct Header {
+        unsigned char identifier[12];
+        uint32_t endianness;
+        uint32_t glType;
+        uint32_t glTypeSize;
+        uint32_t glFormat;
+        uint32_t glInternalFormat;
+        uint32_t glBaseInternalFormat;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t numberOfArrayElements;
+        uint32_t numberOfFaces;
+        uint32_t numberOfMipmapLevels;
+        uint32_t bytesOfKeyValueData;
+    };
+
+    static size_t padding(size_t size)
+    {
+        return (4 - size % 4) % 4;
+    }
+
+    static uint32_t baseFormat(const KtxTexture &texture)
+    {
+        if(!texture.Compressed())
+            return texture.glFormat;
+        switch(texture.glInternalFormat)
+        {
+            case GL_COMPRESSED_RED_RGTC1: return GL_RED;
+            case GL_COMPRESSED_RG_RGTC2: return GL_RG;
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return GL_RGB;
+            default: return GL_RGBA;
+        }
+    }
+};
+#endif
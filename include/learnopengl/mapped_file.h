@@ -0,0 +1,72 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+
+// read-only memory mapping of a whole file. the mapping is released when the object goes out of scope.
+class MappedFile
+{
+public:
+    MappedFile() {}
+
+    explicit MappedFile(const std::string &path)
+    {
+        Open(path);
+    }
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string &path)
+    {
+        Close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void *ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+        if(ptr == MAP_FAILED)
+            return false;
+
+        data = static_cast<const unsigned char*>(ptr);
+        length = (size_t)st.st_size;
+        return true;
+    }
+
+    void Close()
+    {
+        if(data)
+            munmap(const_cast<unsigned char*>(data), length);
+        data = nullptr;
+        length = 0;
+    }
+
+    bool IsOpen() const { return data != nullptr; }
+    const unsigned char *Data() const { return data; }
+    size_t Size() const { return length; }
+
+private:
+    const unsigned char *data = nullptr;
+    size_t length = 0;
+};
+#endif
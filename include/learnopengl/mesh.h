@@ -6,134 +6,260 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/geometry_arena.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_slot.h>
+#include <learnopengl/vertex_format.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-};
-
-
-
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// a material texture the importer found to be a single color, passed to the shader as a constant instead of a
+// sampler (see TextureAtlas). color is the texel value as stored, no sRGB decoding.
+struct MaterialColor {
+    string type;
+    glm::vec4 color;
+};
+
+// what a mesh binds to draw: the gl texture of every slot (0 for none) and the constant colors standing in for
+// single color textures. made once from the imported Texture and MaterialColor lists, so binding it needs neither
+// strings nor uniform lookups. only the first texture of a slot is kept, the shaders declare one sampler per slot.
+struct Material {
+    unsigned int textures[TEXTURE_SLOT_COUNT] = {};
+    glm::vec4 colors[TEXTURE_SLOT_COUNT] = {};
+    unsigned int colorSlots = 0;    // bit per slot that has a constant color
+    // whether the specular alpha, which the lighting shader writes as coverage, can be below 1. the renderer can't
+    // tell from the texture ids, the loader sets it (see Model::AddMesh). blended materials are drawn back to front.
+    bool blended = false;
+
+    Material() = default;
+
+    Material(const vector<Texture> &textureList, const vector<MaterialColor> &colorList)
+    {
+        for(const Texture &texture : textureList)
+        {
+            TextureSlot slot = TextureSlotOf(texture.type);
+            if(slot != TEXTURE_SLOT_COUNT && textures[slot] == 0)
+                textures[slot] = texture.id;
+        }
+        for(const MaterialColor &color : colorList)
+        {
+            TextureSlot slot = TextureSlotOf(color.type);
+            if(slot != TEXTURE_SLOT_COUNT)
+            {
+                colors[slot] = color.color;
+                colorSlots |= 1u << slot;
+            }
+        }
+    }
+
+    bool HasColor(TextureSlot slot) const { return (colorSlots & (1u << slot)) != 0; }
+
+    size_t TextureCount() const
+    {
+        size_t count = 0;
+        for(unsigned int texture : textures)
+            count += texture != 0 ? 1 : 0;
+        return count;
+    }
+
+    // binds the textures to the units of their slots and sets the constant colors of the program's material named
+    // by prefix. textures already bound to their unit are skipped by GLState, which unit is left active is not defined.
+    void Bind(const Shader &shader, const string &prefix) const
+    {
+        const Shader::MaterialUniforms &uniforms = shader.materialUniforms(prefix);
+        for(int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
+        {
+            if(textures[slot] != 0)
+                GLState::BindTexture(slot, GL_TEXTURE_2D, textures[slot]);
+            if(colorSlots & (1u << slot))
+                shader.set(uniforms.colors[slot], colors[slot]);
+        }
+    }
+
+    bool operator==(const Material &other) const
+    {
+        if(colorSlots != other.colorSlots)
+            return false;
+        for(int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
+            if(textures[slot] != other.textures[slot] || (HasColor((TextureSlot)slot) && colors[slot] != other.colors[slot]))
+                return false;
+        return true;
+    }
+};
+
+// the uniforms Mesh::DrawGeometry sets, resolved once per program. meshes of every format set quantizedPosition,
+// programs without it (optimized out) simply get invalid handles.
+struct GeometryUniforms {
+    UniformHandle<bool> quantizedPosition;
+    UniformHandle<glm::vec3> positionOffset;
+    UniformHandle<glm::vec3> positionScale;
+
+    GeometryUniforms() = default;
+    explicit GeometryUniforms(const Shader &shader)
+        : quantizedPosition(shader.uniform<bool>("quantizedPosition")),
+          positionOffset(shader.uniform<glm::vec3>("positionOffset")),
+          positionScale(shader.uniform<glm::vec3>("positionScale"))
+    {
+    }
+};
+
+// a coarser level of detail: indices over the full resolution vertices, and how far (in model units) the
+// simplified surface may stray from the original
+struct MeshLod {
+    vector<unsigned int> indices;
+    float error = 0.0f;
+};
+
+// cpu side mesh as produced by the importers, before anything is uploaded to the gpu.
+// only type and path of the textures are filled in, ids are resolved when the model is built.
+struct MeshData {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<Texture>      textures;
+    vector<MaterialColor> colors;
+    // levels of detail below the full resolution indices, coarsest last
+    vector<MeshLod>      lods;
+};
+
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
-    vector<Texture>      textures;
+    Material             material;
 
-    unsigned int VAO;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // where the mesh lives in the GeometryArena of its model, and the layout of that arena
+    GeometryArena::Range range;
+    VertexFormat format;
+    // every level of detail, the first being range itself
+    struct Lod {
+        GeometryArena::Range range;
+        float error;
+    };
+    vector<Lod> lods;
+    // model space bounds, still there once the cpu geometry is released: the AABB for culling, and the bounding
+    // sphere around its center for level of detail selection
+    glm::vec3 boundsMin, boundsMax;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    // constructor, adds the mesh to the arena it will be drawn from. nothing reaches the gpu before the arena's
+    // Upload. the geometry is moved in, pass it with std::move to avoid copying it; textures and colors become the
+    // mesh's Material.
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, const vector<Texture> &textures, GeometryArena &arena,
+         const vector<MaterialColor> &colors = vector<MaterialColor>())
+        : vertices(std::move(vertices)), indices(std::move(indices)), material(textures, colors)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->format = arena.Format();
+        this->range = arena.Add(this->vertices, this->indices);
+        this->lods.push_back(Lod{range, 0.0f});
+        this->vertexCount = this->vertices.size();
+        computeBounds();
+    }
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+    // the geometry can be large and lives in the model's arena anyway, so meshes are only ever moved
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+
+    // frees the cpu copy of vertices and indices. the gpu buffers, levels of detail and bounds stay, so the mesh
+    // draws as before; only code reading the arrays themselves (none after upload in this project) loses them.
+    void ReleaseGeometry()
+    {
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    size_t VertexCount() const { return vertexCount; }
+
+    // memory the cpu copy of the geometry takes, 0 once released
+    size_t CpuGeometryBytes() const
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+    }
 
+    // adds a coarser level of detail to the arena, levels have to come in order of increasing error
+    void AddLod(const vector<unsigned int> &lodIndices, float error, GeometryArena &arena)
+    {
+        lods.push_back(Lod{arena.AddIndices(range, lodIndices), error});
+    }
+
+    // the coarsest level whose error stays within maxPixels on screen, pixelsPerUnit being the projected size of one
+    // model space unit at the mesh's distance
+    size_t SelectLod(float pixelsPerUnit, float maxPixels) const
+    {
+        size_t lod = 0;
+        while(lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit <= maxPixels)
+            lod++;
+        return lod;
+    }
+
+    // false when the slot was collapsed to a constant color at import, the material is then drawn with a program
+    // variant reading the color instead of the texture
+    bool SamplesDiffuseMap() const { return !material.HasColor(TEXTURE_DIFFUSE); }
+    bool SamplesSpecularMap() const { return !material.HasColor(TEXTURE_SPECULAR); }
 
+    // issues the draw call for the given level of detail, with whatever material is currently bound. uniforms have
+    // to be those of shader.
+    void DrawGeometry(const Shader &shader, const GeometryUniforms &uniforms, size_t lod = 0)
+    {
+        // quantized positions are scaled back in the vertex shader. the flag follows the mesh's format instead of
+        // being switched off after the draw, so it is only uploaded when the format changes between draws; draws that
+        // don't go through Mesh set it to false themselves (see RenderQueue::Submit).
+        bool quantized = format == VERTEX_COMPACT_QUANTIZED;
+        shader.set(uniforms.quantizedPosition, quantized);
+        if(quantized)
+        {
+            shader.set(uniforms.positionOffset, range.positionOffset);
+            shader.set(uniforms.positionScale, range.positionScale);
+        }
 
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        GeometryArena::Draw(lods[lod].range);
+    }
+
+    // size of the mesh's vertices on the gpu, which is also what a draw of the whole mesh fetches at most
+    size_t VertexBytes() const
+    {
+        return vertexCount * GeometryArena::VertexStride(format);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // indices of every level of detail
+    size_t IndexBytes() const
+    {
+        size_t count = 0;
+        for(const Lod &lod : lods)
+            count += lod.range.indexCount;
+        return count * (range.indexType == GL_UNSIGNED_SHORT ? 2 : 4);
     }
 
 private:
-    // render data
-    unsigned int VBO, EBO;
+    size_t vertexCount;
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    void computeBounds()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+        glm::vec3 low(0.0f), high(0.0f);
+        for(size_t i = 0; i < vertices.size(); i++)
+        {
+            low = i == 0 ? vertices[i].Position : glm::min(low, vertices[i].Position);
+            high = i == 0 ? vertices[i].Position : glm::max(high, vertices[i].Position);
+        }
+        boundsMin = low;
+        boundsMax = high;
+        boundsCenter = (low + high) * 0.5f;
+        boundsRadius = 0.0f;
+        for(const Vertex &vertex : vertices)
+            boundsRadius = std::max(boundsRadius, glm::length(vertex.Position - boundsCenter));
     }
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,375 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/obj_parser.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// binary cache of imported meshes. the file sits next to the source model (<model>.meshcache) and holds the
+// processed Vertex/index arrays plus the material texture references and constant colors of every mesh. it is
+// keyed by the hash of the source file (and the .mtl libraries it references, with the images those name), the
+// import flags and the Vertex layout, so a stale cache is simply ignored and rebuilt by the caller.
+//
+// layout: header | mesh table | texture table | color table | lod table | string blob |
+//         16 byte aligned vertex and index data, each mesh followed by the indices of its levels of detail
+class MeshCache
+{
+public:
+    // bump whenever the file layout or the import pipeline output changes
+    static const uint32_t VERSION = 4;
+
+    static string PathFor(const string &sourcePath)
+    {
+        return sourcePath + ".meshcache";
+    }
+
+    // hash of the source file and, for wavefront files, of the material libraries it pulls in and the texture
+    // images they reference (the import pass in TextureAtlas looks at their texels). returns 0 if the source can't
+    // be read. reads every one of those files, so an import computes it once and hands it to Load, Store and
+    // TextureAtlas.
+    static uint64_t SourceKey(const string &sourcePath)
+    {
+        MappedFile source(sourcePath);
+        if(!source.IsOpen())
+            return 0;
+        uint64_t key = ContentHash::Bytes(source.Data(), source.Size());
+
+        string directory = sourcePath.substr(0, sourcePath.find_last_of('/'));
+        const char *p = reinterpret_cast<const char*>(source.Data());
+        const char *end = p + source.Size();
+        while(p < end)
+        {
+            const char *lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if(!lineEnd)
+                lineEnd = end;
+            if(lineEnd - p > 7 && strncmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+            {
+                string name(p + 7, lineEnd);
+                while(!name.empty() && (name.back() == '\r' || name.back() == ' ' || name.back() == '\t'))
+                    name.pop_back();
+                MappedFile library(directory + '/' + name);
+                if(library.IsOpen())
+                {
+                    key = ContentHash::Combine(key, ContentHash::Bytes(library.Data(), library.Size()));
+                    key = hashTextureMaps(directory, library, key);
+                }
+            }
+            p = lineEnd + 1;
+        }
+        return key;
+    }
+
+    // fills meshes from the cache if it exists and matches the source (sourceKey, see SourceKey) and flags. returns
+    // false on any mismatch.
+    static bool Load(const string &sourcePath, unsigned int importFlags, uint64_t sourceKey, vector<MeshData> &meshes)
+    {
+        MappedFile file(PathFor(sourcePath));
+        if(!file.IsOpen() || file.Size() < sizeof(Header))
+            return false;
+
+        const unsigned char *base = file.Data();
+        Header header;
+        memcpy(&header, base, sizeof(Header));
+        if(memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION || header.vertexSize != sizeof(Vertex) ||
+           header.importFlags != importFlags)
+            return false;
+        if(sourceKey == 0 || header.sourceKey != sourceKey)
+            return false;
+
+        uint64_t meshTableEnd = sizeof(Header) + uint64_t(header.meshCount) * sizeof(MeshEntry);
+        uint64_t textureTableEnd = meshTableEnd + uint64_t(header.textureCount) * sizeof(TextureEntry);
+        uint64_t colorTableEnd = textureTableEnd + uint64_t(header.colorCount) * sizeof(ColorEntry);
+        uint64_t lodTableEnd = colorTableEnd + uint64_t(header.lodCount) * sizeof(LodEntry);
+        if(lodTableEnd > file.Size() || header.stringsOffset + header.stringsSize > file.Size())
+            return false;
+        const MeshEntry *entries = reinterpret_cast<const MeshEntry*>(base + sizeof(Header));
+        const TextureEntry *textureEntries = reinterpret_cast<const TextureEntry*>(base + meshTableEnd);
+        const ColorEntry *colorEntries = reinterpret_cast<const ColorEntry*>(base + textureTableEnd);
+        const LodEntry *lodEntries = reinterpret_cast<const LodEntry*>(base + colorTableEnd);
+        const char *strings = reinterpret_cast<const char*>(base + header.stringsOffset);
+
+        vector<MeshData> result(header.meshCount);
+        for(uint32_t i = 0; i < header.meshCount; i++)
+        {
+            const MeshEntry &e = entries[i];
+            if(e.vertexOffset + uint64_t(e.vertexCount) * sizeof(Vertex) > file.Size() ||
+               e.indexOffset + uint64_t(e.indexCount) * sizeof(unsigned int) > file.Size() ||
+               uint64_t(e.firstTexture) + e.textureCount > header.textureCount ||
+               uint64_t(e.firstColor) + e.colorCount > header.colorCount ||
+               uint64_t(e.firstLod) + e.lodCount > header.lodCount)
+                return false;
+
+            // plain copies straight out of the mapping, nothing is parsed
+            const Vertex *vertices = reinterpret_cast<const Vertex*>(base + e.vertexOffset);
+            const unsigned int *indices = reinterpret_cast<const unsigned int*>(base + e.indexOffset);
+            result[i].vertices.assign(vertices, vertices + e.vertexCount);
+            result[i].indices.assign(indices, indices + e.indexCount);
+
+            for(uint32_t t = 0; t < e.textureCount; t++)
+            {
+                const TextureEntry &te = textureEntries[e.firstTexture + t];
+                if(uint64_t(te.typeOffset) + te.typeLength > header.stringsSize ||
+                   uint64_t(te.pathOffset) + te.pathLength > header.stringsSize)
+                    return false;
+                Texture texture;
+                texture.id = 0;
+                texture.type.assign(strings + te.typeOffset, te.typeLength);
+                texture.path.assign(strings + te.pathOffset, te.pathLength);
+                result[i].textures.push_back(texture);
+            }
+            for(uint32_t c = 0; c < e.colorCount; c++)
+            {
+                const ColorEntry &ce = colorEntries[e.firstColor + c];
+                if(uint64_t(ce.typeOffset) + ce.typeLength > header.stringsSize)
+                    return false;
+                MaterialColor color;
+                color.type.assign(strings + ce.typeOffset, ce.typeLength);
+                color.color = glm::vec4(ce.color[0], ce.color[1], ce.color[2], ce.color[3]);
+                result[i].colors.push_back(color);
+            }
+            for(uint32_t l = 0; l < e.lodCount; l++)
+            {
+                const LodEntry &le = lodEntries[e.firstLod + l];
+                if(le.indexOffset + uint64_t(le.indexCount) * sizeof(unsigned int) > file.Size())
+                    return false;
+                const unsigned int *lodIndices = reinterpret_cast<const unsigned int*>(base + le.indexOffset);
+                MeshLod lod;
+                lod.indices.assign(lodIndices, lodIndices + le.indexCount);
+                lod.error = le.error;
+                result[i].lods.push_back(std::move(lod));
+            }
+        }
+        meshes.swap(result);
+        return true;
+    }
+
+    // writes the cache for the given source. the file is written under a temporary name and renamed into place,
+    // so a crash mid-write never leaves a truncated cache behind.
+    static bool Store(const string &sourcePath, unsigned int importFlags, uint64_t sourceKey, const vector<MeshData> &meshes)
+    {
+        Header header;
+        memcpy(header.magic, MAGIC, 4);
+        header.version = VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.importFlags = importFlags;
+        header.sourceKey = sourceKey;
+        if(header.sourceKey == 0)
+            return false;
+        header.meshCount = (uint32_t)meshes.size();
+        header.textureCount = 0;
+        header.colorCount = 0;
+        header.lodCount = 0;
+
+        vector<MeshEntry> entries(meshes.size());
+        vector<TextureEntry> textureEntries;
+        vector<ColorEntry> colorEntries;
+        vector<LodEntry> lodEntries;
+        string strings;
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            entries[i].firstTexture = (uint32_t)textureEntries.size();
+            entries[i].textureCount = (uint32_t)meshes[i].textures.size();
+            for(const Texture &texture : meshes[i].textures)
+            {
+                TextureEntry te;
+                te.typeOffset = (uint32_t)strings.size();
+                te.typeLength = (uint32_t)texture.type.size();
+                strings += texture.type;
+                te.pathOffset = (uint32_t)strings.size();
+                te.pathLength = (uint32_t)texture.path.size();
+                strings += texture.path;
+                textureEntries.push_back(te);
+            }
+            entries[i].firstColor = (uint32_t)colorEntries.size();
+            entries[i].colorCount = (uint32_t)meshes[i].colors.size();
+            for(const MaterialColor &color : meshes[i].colors)
+            {
+                ColorEntry ce;
+                ce.typeOffset = (uint32_t)strings.size();
+                ce.typeLength = (uint32_t)color.type.size();
+                strings += color.type;
+                for(int c = 0; c < 4; c++)
+                    ce.color[c] = color.color[c];
+                colorEntries.push_back(ce);
+            }
+            entries[i].firstLod = (uint32_t)lodEntries.size();
+            entries[i].lodCount = (uint32_t)meshes[i].lods.size();
+            for(const MeshLod &lod : meshes[i].lods)
+            {
+                LodEntry le;
+                le.indexOffset = 0;
+                le.indexCount = (uint32_t)lod.indices.size();
+                le.error = lod.error;
+                lodEntries.push_back(le);
+            }
+        }
+        header.textureCount = (uint32_t)textureEntries.size();
+        header.colorCount = (uint32_t)colorEntries.size();
+        header.lodCount = (uint32_t)lodEntries.size();
+        header.stringsOffset = sizeof(Header) + entries.size() * sizeof(MeshEntry) + textureEntries.size() * sizeof(TextureEntry) +
+                               colorEntries.size() * sizeof(ColorEntry) + lodEntries.size() * sizeof(LodEntry);
+        header.stringsSize = strings.size();
+
+        uint64_t offset = align(header.stringsOffset + header.stringsSize);
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            entries[i].vertexOffset = offset;
+            entries[i].vertexCount = (uint32_t)meshes[i].vertices.size();
+            offset = align(offset + meshes[i].vertices.size() * sizeof(Vertex));
+            entries[i].indexOffset = offset;
+            entries[i].indexCount = (uint32_t)meshes[i].indices.size();
+            offset = align(offset + meshes[i].indices.size() * sizeof(unsigned int));
+            for(uint32_t l = 0; l < entries[i].lodCount; l++)
+            {
+                LodEntry &le = lodEntries[entries[i].firstLod + l];
+                le.indexOffset = offset;
+                offset = align(offset + uint64_t(le.indexCount) * sizeof(unsigned int));
+            }
+        }
+
+        string cachePath = PathFor(sourcePath);
+        string tmpPath = cachePath + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            if(!out)
+                return false;
+            uint64_t written = 0;
+            auto put = [&](const void *data, size_t size) {
+                out.write(static_cast<const char*>(data), size);
+                written += size;
+            };
+            auto pad = [&]() {
+                static const char zeros[ALIGNMENT] = {};
+                put(zeros, align(written) - written);
+            };
+            put(&header, sizeof(Header));
+            put(entries.data(), entries.size() * sizeof(MeshEntry));
+            put(textureEntries.data(), textureEntries.size() * sizeof(TextureEntry));
+            put(colorEntries.data(), colorEntries.size() * sizeof(ColorEntry));
+            put(lodEntries.data(), lodEntries.size() * sizeof(LodEntry));
+            put(strings.data(), strings.size());
+            pad();
+            for(const MeshData &mesh : meshes)
+            {
+                put(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+                pad();
+                put(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+                pad();
+                for(const MeshLod &lod : mesh.lods)
+                {
+                    put(lod.indices.data(), lod.indices.size() * sizeof(unsigned int));
+                    pad();
+                }
+            }
+            if(!out)
+            {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+        }
+        if(std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr const char *MAGIC = "RGMC";
+    static const uint64_t ALIGNMENT = 16;
+
+    struct Header {
+        char     magic[4];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t importFlags;
+        uint64_t sourceKey;
+        uint32_t meshCount;
+        uint32_t textureCount;
+        uint32_t colorCount;
+        uint32_t lodCount;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+
+    struct MeshEntry {
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t firstTexture;
+        uint32_t textureCount;
+        uint32_t firstColor;
+        uint32_t colorCount;
+        uint32_t firstLod;
+        uint32_t lodCount;
+    };
+
+    struct TextureEntry {
+        uint32_t typeOffset;
+        uint32_t typeLength;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+    };
+
+    struct ColorEntry {
+        uint32_t typeOffset;
+        uint32_t typeLength;
+        float    color[4];
+    };
+
+    struct LodEntry {
+        uint64_t indexOffset;
+        uint32_t indexCount;
+        float    error;
+    };
+
+    // folds the images named by the map_* statements of a material library into key. the path is everything after
+    // the options (-bm 1.0 and the like), as ObjParser reads it.
+    static uint64_t hashTextureMaps(const string &directory, const MappedFile &library, uint64_t key)
+    {
+        const char *p = reinterpret_cast<const char*>(library.Data());
+        const char *end = p + library.Size();
+        while(p < end)
+        {
+            const char *lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if(!lineEnd)
+                lineEnd = end;
+            while(p < lineEnd && (*p == ' ' || *p == '\t'))
+                p++;
+            if(lineEnd - p > 4 && strncmp(p, "map_", 4) == 0)
+            {
+                const char *keywordEnd = p;
+                while(keywordEnd < lineEnd && *keywordEnd != ' ' && *keywordEnd != '\t')
+                    keywordEnd++;
+                string name = ObjParser::MapPath(keywordEnd, lineEnd);
+                if(!name.empty())
+                {
+                    MappedFile image(directory + '/' + name);
+                    if(image.IsOpen())
+                        key = ContentHash::Combine(key, ContentHash::Bytes(image.Data(), image.Size()));
+                }
+            }
+            p = lineEnd + 1;
+        }
+        return key;
+    }
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+};
+#endif
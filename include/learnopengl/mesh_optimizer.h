@@ -0,0 +1,335 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// import time optimization of indexed triangle meshes, in the order the stages depend on each other:
+//  1. Weld: merges bit identical vertices through a hash table
+//  2. RemoveDegenerates: drops triangles with a repeated index or zero area
+//  3. OptimizeVertexCache: reorders triangles for the post-transform cache (Forsyth's linear speed algorithm)
+//  4. OptimizeOverdraw: splits that order into clusters and draws outward facing clusters first (Sander et al.)
+//  5. OptimizeVertexFetch: renumbers vertices in order of first use, so fetches walk the buffer linearly
+// Optimize runs all of them and reports the before/after statistics.
+class MeshOptimizer
+{
+public:
+    // size of the simulated FIFO cache the statistics are measured with, typical of current hardware
+    static const unsigned int CACHE_SIZE = 16;
+
+    struct Stats {
+        size_t vertices = 0;
+        size_t triangles = 0;
+        // average cache miss ratio: transformed vertices per triangle, 0.5 is the ideal for large grids, 3 the worst
+        float acmr = 0.0f;
+        // average transform to vertex ratio: transformed vertices per unique vertex, 1 is the ideal
+        float atvr = 0.0f;
+    };
+
+    static Stats Analyze(const vector<Vertex> &vertices, const vector<unsigned int> &indices, unsigned int cacheSize = CACHE_SIZE)
+    {
+        Stats stats;
+        stats.vertices = vertices.size();
+        stats.triangles = indices.size() / 3;
+        vector<unsigned int> cache;
+        size_t misses = 0;
+        for(unsigned int index : indices)
+        {
+            if(std::find(cache.begin(), cache.end(), index) != cache.end())
+                continue;
+            misses++;
+            cache.push_back(index);
+            if(cache.size() > cacheSize)
+                cache.erase(cache.begin());
+        }
+        if(stats.triangles > 0)
+            stats.acmr = float(misses) / stats.triangles;
+        if(stats.vertices > 0)
+            stats.atvr = float(misses) / stats.vertices;
+        return stats;
+    }
+
+    // runs every stage on the mesh, before and after receive the statistics of the input and the result
+    static void Optimize(MeshData &mesh, Stats *before = nullptr, Stats *after = nullptr)
+    {
+        if(before)
+            *before = Analyze(mesh.vertices, mesh.indices);
+        Weld(mesh.vertices, mesh.indices);
+        RemoveDegenerates(mesh.vertices, mesh.indices);
+        OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+        OptimizeOverdraw(mesh.vertices, mesh.indices);
+        OptimizeVertexFetch(mesh.vertices, mesh.indices);
+        if(after)
+            *after = Analyze(mesh.vertices, mesh.indices);
+    }
+
+    static void Weld(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        struct VertexHash {
+            size_t operator()(const Vertex &v) const { return (size_t)ContentHash::Bytes(&v, sizeof(Vertex)); }
+        };
+        struct VertexEqual {
+            bool operator()(const Vertex &a, const Vertex &b) const { return memcmp(&a, &b, sizeof(Vertex)) == 0; }
+        };
+        unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+        unique.reserve(vertices.size());
+        vector<unsigned int> remap(vertices.size());
+        vector<Vertex> welded;
+        welded.reserve(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++)
+        {
+            auto inserted = unique.emplace(vertices[i], (unsigned int)welded.size());
+            if(inserted.second)
+                welded.push_back(vertices[i]);
+            remap[i] = inserted.first->second;
+        }
+        for(unsigned int &index : indices)
+            index = remap[index];
+        vertices.swap(welded);
+    }
+
+    static void RemoveDegenerates(const vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        size_t kept = 0;
+        for(size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            unsigned int a = indices[t], b = indices[t + 1], c = indices[t + 2];
+            if(a == b || b == c || a == c)
+                continue;
+            glm::vec3 normal = glm::cross(vertices[b].Position - vertices[a].Position, vertices[c].Position - vertices[a].Position);
+            if(normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f)
+                continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+    }
+
+    // Tom Forsyth, "Linear-Speed Vertex Cache Optimisation": greedily emits the triangle with the highest score,
+    // scores favoring vertices recently used (cache position) and vertices with few triangles left (valence)
+    static void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+    {
+        const int cacheSize = 32;
+        size_t triangleCount = indices.size() / 3;
+        if(triangleCount == 0)
+            return;
+
+        // triangles using each vertex, as offsets into one adjacency array
+        vector<unsigned int> remaining(vertexCount, 0);
+        for(unsigned int index : indices)
+            remaining[index]++;
+        vector<unsigned int> offsets(vertexCount + 1, 0);
+        for(size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + remaining[v];
+        vector<unsigned int> adjacency(indices.size());
+        {
+            vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for(size_t t = 0; t < triangleCount; t++)
+                for(int k = 0; k < 3; k++)
+                    adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+        }
+
+        vector<int> cachePosition(vertexCount, -1);
+        vector<float> vertexScore(vertexCount);
+        for(size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = forsythScore(-1, remaining[v], cacheSize);
+        vector<float> triangleScore(triangleCount);
+        for(size_t t = 0; t < triangleCount; t++)
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        vector<bool> emitted(triangleCount, false);
+
+        vector<unsigned int> result;
+        result.reserve(indices.size());
+        vector<unsigned int> cache, nextCache;
+        size_t cursor = 0;
+        long best = -1;
+        while(result.size() < indices.size())
+        {
+            if(best < 0)
+            {
+                // nothing in the cache has triangles left, continue with the next unemitted one in input order
+                while(emitted[cursor])
+                    cursor++;
+                best = (long)cursor;
+            }
+            size_t t = (size_t)best;
+            emitted[t] = true;
+
+            // emitted vertices move to the front of the cache, the rest shift back
+            nextCache.clear();
+            for(int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[t * 3 + k];
+                result.push_back(v);
+                nextCache.push_back(v);
+                // drop the triangle from the vertex's adjacency
+                unsigned int *begin = &adjacency[offsets[v]], *end = begin + remaining[v];
+                std::swap(*std::find(begin, end, (unsigned int)t), *(end - 1));
+                remaining[v]--;
+            }
+            for(unsigned int v : cache)
+                if(std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+                    nextCache.push_back(v);
+            // vertices pushed out of the cache lose their position score
+            for(size_t i = cacheSize; i < nextCache.size(); i++)
+            {
+                unsigned int v = nextCache[i];
+                cachePosition[v] = -1;
+                float score = forsythScore(-1, remaining[v], cacheSize);
+                for(unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+                    triangleScore[adjacency[a]] += score - vertexScore[v];
+                vertexScore[v] = score;
+            }
+            if(nextCache.size() > (size_t)cacheSize)
+                nextCache.resize(cacheSize);
+            cache.swap(nextCache);
+
+            // rescore the cached vertices and their triangles, remembering the best one for the next step
+            best = -1;
+            float bestScore = -1.0f;
+            for(size_t i = 0; i < cache.size(); i++)
+            {
+                unsigned int v = cache[i];
+                cachePosition[v] = (int)i;
+                float score = forsythScore((int)i, remaining[v], cacheSize);
+                float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+                for(unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+                {
+                    unsigned int triangle = adjacency[a];
+                    triangleScore[triangle] += delta;
+                    if(triangleScore[triangle] > bestScore)
+                    {
+                        bestScore = triangleScore[triangle];
+                        best = triangle;
+                    }
+                }
+            }
+        }
+        indices.swap(result);
+    }
+
+    // splits the triangle order into clusters wherever the vertex cache had to start over (all three vertices of a
+    // triangle missing) and sorts the clusters so those facing away from the mesh center, which tend to occlude the
+    // rest, are drawn first. keeps the cache efficiency inside clusters while cutting overdraw.
+    static void OptimizeOverdraw(const vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if(triangleCount < 2)
+            return;
+
+        vector<size_t> clusterStart;
+        vector<unsigned int> cache;
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            int misses = 0;
+            for(int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[t * 3 + k];
+                if(std::find(cache.begin(), cache.end(), v) != cache.end())
+                    continue;
+                misses++;
+                cache.push_back(v);
+                if(cache.size() > CACHE_SIZE)
+                    cache.erase(cache.begin());
+            }
+            if(t == 0 || misses == 3)
+                clusterStart.push_back(t);
+        }
+        clusterStart.push_back(triangleCount);
+        size_t clusterCount = clusterStart.size() - 1;
+        if(clusterCount < 2)
+            return;
+
+        // area weighted centroid of the mesh and of every cluster, summed face normal of every cluster
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f)), normals(clusterCount, glm::vec3(0.0f));
+        vector<float> areas(clusterCount, 0.0f);
+        for(size_t c = 0; c < clusterCount; c++)
+            for(size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+            {
+                const glm::vec3 &a = vertices[indices[t * 3]].Position;
+                const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &d = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 normal = glm::cross(b - a, d - a);
+                float area = glm::length(normal);
+                glm::vec3 center = (a + b + d) / 3.0f;
+                centroids[c] += center * area;
+                areas[c] += area;
+                normals[c] += normal;
+                meshCentroid += center * area;
+                meshArea += area;
+            }
+        if(meshArea > 0.0f)
+            meshCentroid /= meshArea;
+
+        vector<float> sortKey(clusterCount);
+        for(size_t c = 0; c < clusterCount; c++)
+        {
+            glm::vec3 centroid = areas[c] > 0.0f ? centroids[c] / areas[c] : meshCentroid;
+            float length = glm::length(normals[c]);
+            sortKey[c] = length > 0.0f ? glm::dot(centroid - meshCentroid, normals[c] / length) : 0.0f;
+        }
+        vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+        vector<unsigned int> result;
+        result.reserve(indices.size());
+        for(size_t c : order)
+            result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+        indices.swap(result);
+    }
+
+    // renumbers vertices in order of first reference and drops unreferenced ones
+    static void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        const unsigned int unused = ~0u;
+        vector<unsigned int> remap(vertices.size(), unused);
+        vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for(unsigned int &index : indices)
+        {
+            if(remap[index] == unused)
+            {
+                remap[index] = (unsigned int)ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(ordered);
+    }
+
+private:
+    static float forsythScore(int cachePosition, unsigned int remainingTriangles, int cacheSize)
+    {
+        if(remainingTriangles == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if(cachePosition >= 0)
+        {
+            // the three vertices of the last triangle get a fixed score, so it doesn't matter which one goes first
+            if(cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / float(cacheSize - 3), 1.5f);
+        }
+        // boost vertices with few triangles left, so the algorithm finishes off regions instead of leaving islands
+        score += 2.0f * std::pow(float(remainingTriangles), -0.5f);
+        return score;
+    }
+};
+#endif
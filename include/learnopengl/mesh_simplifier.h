@@ -0,0 +1,351 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// quadric error edge collapse simplification (Garland and Heckbert) producing index buffers over the original
+// vertices, so every level of detail of a mesh draws from the vertex buffer its full resolution already uses.
+// collapses work on positions: all vertices sharing a position (wedges, split for their normals or uvs) move
+// together, each onto the wedge of the target position it shares an edge with. a collapse where some wedge has no
+// such partner would tear the surface open at a seam and is skipped, as are collapses of vertices on open borders,
+// which keeps the silhouette and the texture mapping intact.
+class MeshSimplifier
+{
+public:
+    // levels generated per mesh, including the full resolution one
+    static const size_t MAX_LODS = 4;
+    // a level has to drop at least this share of the previous one's triangles to be kept
+    constexpr static const float MIN_REDUCTION = 0.1f;
+    // collapses are not allowed to move the surface by more than this share of the mesh radius
+    constexpr static const float MAX_RELATIVE_ERROR = 0.1f;
+
+    // collapses edges, cheapest first, until at most targetIndexCount indices are left or no collapse stays below
+    // maxError (in model units). error receives the largest error of any collapse done, in model units.
+    static vector<unsigned int> Simplify(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t targetIndexCount,
+                                         float maxError, float *error = nullptr)
+    {
+        vector<unsigned int> result = indices;
+        if(error)
+            *error = 0.0f;
+        size_t vertexCount = vertices.size();
+        if(result.size() <= targetIndexCount || vertexCount == 0)
+            return result;
+
+        vector<unsigned int> wedge = positionRemap(vertices);
+        // the wedges of a position as a ring, each vertex linking to the next at the same position
+        vector<unsigned int> ring(vertexCount);
+        for(size_t v = 0; v < vertexCount; v++)
+        {
+            unsigned int first = wedge[v];
+            if(first == v)
+                ring[v] = (unsigned int)v;
+            else
+            {
+                ring[v] = ring[first];
+                ring[first] = (unsigned int)v;
+            }
+        }
+        vector<unsigned char> locked = borderPositions(result, wedge);
+        vector<Quadric> quadrics(vertexCount);
+        for(size_t t = 0; t + 2 < result.size(); t += 3)
+        {
+            Quadric plane = planeQuadric(vertices[result[t]].Position, vertices[result[t + 1]].Position, vertices[result[t + 2]].Position);
+            for(int k = 0; k < 3; k++)
+                quadrics[wedge[result[t + k]]].Add(plane);
+        }
+
+        double errorLimit = double(maxError) * maxError;
+        double largest = 0.0;
+        vector<unsigned int> collapse(vertexCount);
+        vector<unsigned char> touched(vertexCount);
+        vector<pair<unsigned int, unsigned int>> moves;
+        while(result.size() > targetIndexCount)
+        {
+            // triangles around each vertex
+            vector<unsigned int> offsets(vertexCount + 1, 0);
+            for(unsigned int index : result)
+                offsets[index + 1]++;
+            for(size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] += offsets[v];
+            vector<unsigned int> around(result.size());
+            vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for(size_t i = 0; i < result.size(); i++)
+                around[fill[result[i]]++] = (unsigned int)(i / 3);
+
+            vector<Candidate> candidates;
+            candidates.reserve(result.size());
+            for(size_t t = 0; t + 2 < result.size(); t += 3)
+                for(int k = 0; k < 3; k++)
+                {
+                    unsigned int from = wedge[result[t + k]], to = wedge[result[t + (k + 1) % 3]];
+                    for(int direction = 0; direction < 2; direction++, std::swap(from, to))
+                    {
+                        if(locked[from])
+                            continue;
+                        Quadric q = quadrics[from];
+                        q.Add(quadrics[to]);
+                        candidates.push_back(Candidate{q.Error(vertices[to].Position), from, to});
+                    }
+                }
+            std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) { return a.cost < b.cost; });
+
+            // independent collapses only: once a position moved, nothing around it is looked at again this pass
+            for(size_t v = 0; v < vertexCount; v++)
+                collapse[v] = (unsigned int)v;
+            std::fill(touched.begin(), touched.end(), 0);
+            size_t removable = (result.size() - targetIndexCount) / 3;
+            size_t removed = 0, collapses = 0;
+            for(const Candidate &candidate : candidates)
+            {
+                if(removed >= removable || candidate.cost > errorLimit)
+                    break;
+                unsigned int from = candidate.from, to = candidate.to;
+                if(touched[from] || touched[to])
+                    continue;
+                if(!partners(vertices, result, around, offsets, wedge, ring, from, to, moves) || flips(vertices, result, around, offsets, moves))
+                    continue;
+                for(const auto &move : moves)
+                {
+                    collapse[move.first] = move.second;
+                    for(unsigned int i = offsets[move.first]; i < offsets[move.first + 1]; i++)
+                    {
+                        size_t t = around[i] * 3;
+                        bool shared = wedge[result[t]] == to || wedge[result[t + 1]] == to || wedge[result[t + 2]] == to;
+                        removed += shared ? 1 : 0;
+                        for(int k = 0; k < 3; k++)
+                            touched[wedge[result[t + k]]] = 1;
+                    }
+                }
+                touched[from] = touched[to] = 1;
+                quadrics[to].Add(quadrics[from]);
+                largest = std::max(largest, candidate.cost);
+                collapses++;
+            }
+            if(collapses == 0)
+                break;
+
+            size_t kept = 0;
+            for(size_t t = 0; t + 2 < result.size(); t += 3)
+            {
+                unsigned int a = collapse[result[t]], b = collapse[result[t + 1]], c = collapse[result[t + 2]];
+                if(wedge[a] == wedge[b] || wedge[b] == wedge[c] || wedge[a] == wedge[c])
+                    continue;
+                result[kept++] = a;
+                result[kept++] = b;
+                result[kept++] = c;
+            }
+            result.resize(kept);
+        }
+        if(error)
+            *error = float(std::sqrt(largest));
+        return result;
+    }
+
+    // fills mesh.lods with up to MAX_LODS - 1 coarser levels, each about half the triangles of the one before and
+    // reordered for the vertex cache. errors add up along the chain, each level is simplified from the previous.
+    static void GenerateLods(MeshData &mesh)
+    {
+        mesh.lods.clear();
+        float radius = boundingRadius(mesh.vertices);
+        const vector<unsigned int> *previous = &mesh.indices;
+        float error = 0.0f;
+        while(mesh.lods.size() + 1 < MAX_LODS && previous->size() >= 3 * 32)
+        {
+            size_t target = previous->size() / 6 * 3;
+            float levelError = 0.0f;
+            vector<unsigned int> indices = Simplify(mesh.vertices, *previous, target, radius * MAX_RELATIVE_ERROR, &levelError);
+            if(float(indices.size()) > float(previous->size()) * (1.0f - MIN_REDUCTION))
+                break;
+            MeshOptimizer::OptimizeVertexCache(indices, mesh.vertices.size());
+            error += levelError;
+            MeshLod lod;
+            lod.indices.swap(indices);
+            lod.error = error;
+            mesh.lods.push_back(std::move(lod));
+            previous = &mesh.lods.back().indices;
+        }
+    }
+
+private:
+    // symmetric 4x4 error matrix of a set of planes, scaled by their areas; Error divides by the summed area so it
+    // comes out as a mean squared distance
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0, c = 0;
+        double weight = 0;
+
+        void Add(const Quadric &q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+            weight += q.weight;
+        }
+
+        double Error(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                       2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Candidate {
+        double cost;
+        unsigned int from, to;
+    };
+
+    static Quadric planeQuadric(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+    {
+        double ux = double(p1.x) - p0.x, uy = double(p1.y) - p0.y, uz = double(p1.z) - p0.z;
+        double vx = double(p2.x) - p0.x, vy = double(p2.y) - p0.y, vz = double(p2.z) - p0.z;
+        double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+        double area = std::sqrt(nx * nx + ny * ny + nz * nz);
+        Quadric q;
+        if(area == 0.0)
+            return q;
+        nx /= area; ny /= area; nz /= area;
+        double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+        q.a00 = nx * nx * area; q.a01 = nx * ny * area; q.a02 = nx * nz * area;
+        q.a11 = ny * ny * area; q.a12 = ny * nz * area; q.a22 = nz * nz * area;
+        q.b0 = nx * d * area; q.b1 = ny * d * area; q.b2 = nz * d * area;
+        q.c = d * d * area;
+        q.weight = area;
+        return q;
+    }
+
+    // first vertex at each position; vertices split for their attributes map to the same one
+    static vector<unsigned int> positionRemap(const vector<Vertex> &vertices)
+    {
+        struct PositionHash {
+            size_t operator()(const glm::vec3 &p) const { return (size_t)ContentHash::Bytes(&p, sizeof(glm::vec3)); }
+        };
+        struct PositionEqual {
+            bool operator()(const glm::vec3 &a, const glm::vec3 &b) const { return memcmp(&a, &b, sizeof(glm::vec3)) == 0; }
+        };
+        unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> first;
+        first.reserve(vertices.size());
+        vector<unsigned int> remap(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++)
+            remap[i] = first.emplace(vertices[i].Position, (unsigned int)i).first->second;
+        return remap;
+    }
+
+    // positions on an edge only one triangle uses. edges are compared by position, so seams aren't borders.
+    static vector<unsigned char> borderPositions(const vector<unsigned int> &indices, const vector<unsigned int> &wedge)
+    {
+        vector<unsigned char> locked(wedge.size(), 0);
+        unordered_map<uint64_t, unsigned int> edges;
+        edges.reserve(indices.size());
+        auto key = [&](size_t t, int k) {
+            unsigned int a = wedge[indices[t + k]], b = wedge[indices[t + (k + 1) % 3]];
+            return (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+        };
+        for(size_t t = 0; t + 2 < indices.size(); t += 3)
+            for(int k = 0; k < 3; k++)
+                edges[key(t, k)]++;
+        for(size_t t = 0; t + 2 < indices.size(); t += 3)
+            for(int k = 0; k < 3; k++)
+                if(edges[key(t, k)] == 1)
+                    locked[wedge[indices[t + k]]] = locked[wedge[indices[t + (k + 1) % 3]]] = 1;
+        return locked;
+    }
+
+    // pairs every wedge of position from with a wedge of position to: the one it shares a triangle with, or else
+    // the one with the same uvs and the closest normal (wedges split only for their normals, along hard edges).
+    // false when some wedge has neither, collapsing would then tear the texture mapping along a uv seam.
+    static bool partners(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<unsigned int> &around,
+                         const vector<unsigned int> &offsets, const vector<unsigned int> &wedge, const vector<unsigned int> &ring,
+                         unsigned int from, unsigned int to, vector<pair<unsigned int, unsigned int>> &moves)
+    {
+        moves.clear();
+        unsigned int w = from;
+        do
+        {
+            // a wedge no triangle uses anymore has nothing to keep consistent
+            if(offsets[w] != offsets[w + 1])
+            {
+                unsigned int partner = ~0u;
+                for(unsigned int i = offsets[w]; i < offsets[w + 1] && partner == ~0u; i++)
+                    for(int k = 0; k < 3; k++)
+                        if(wedge[indices[around[i] * 3 + k]] == to)
+                            partner = indices[around[i] * 3 + k];
+                unsigned int sameUv = ~0u;
+                float closest = -2.0f;
+                unsigned int q = to;
+                do
+                {
+                    glm::vec2 uv = vertices[q].TexCoords - vertices[w].TexCoords;
+                    float alignment = glm::dot(vertices[q].Normal, vertices[w].Normal);
+                    if(std::fabs(uv.x) <= 1e-5f && std::fabs(uv.y) <= 1e-5f && alignment > closest)
+                    {
+                        sameUv = q;
+                        closest = alignment;
+                    }
+                    q = ring[q];
+                } while(q != to);
+                if(partner == ~0u)
+                    partner = sameUv;
+                if(partner == ~0u)
+                    return false;
+                moves.push_back(make_pair(w, partner));
+            }
+            w = ring[w];
+        } while(w != from);
+        return !moves.empty();
+    }
+
+    // whether any triangle around the moved wedges turns over
+    static bool flips(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<unsigned int> &around,
+                      const vector<unsigned int> &offsets, const vector<pair<unsigned int, unsigned int>> &moves)
+    {
+        for(const auto &move : moves)
+            for(unsigned int i = offsets[move.first]; i < offsets[move.first + 1]; i++)
+            {
+                size_t t = around[i] * 3;
+                glm::vec3 p[3];
+                bool collapsing = false;
+                for(int k = 0; k < 3; k++)
+                {
+                    unsigned int index = indices[t + k];
+                    collapsing = collapsing || vertices[index].Position == vertices[move.second].Position;
+                    p[k] = vertices[index].Position;
+                }
+                if(collapsing)
+                    continue;
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for(int k = 0; k < 3; k++)
+                    if(indices[t + k] == move.first)
+                        p[k] = vertices[move.second].Position;
+                glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                if(glm::dot(before, after) <= 0.0f)
+                    return true;
+            }
+        return false;
+    }
+
+    static float boundingRadius(const vector<Vertex> &vertices)
+    {
+        if(vertices.empty())
+            return 0.0f;
+        glm::vec3 low = vertices[0].Position, high = vertices[0].Position;
+        for(const Vertex &vertex : vertices)
+        {
+            low = glm::min(low, vertex.Position);
+            high = glm::max(high, vertex.Position);
+        }
+        return glm::length(high - low) * 0.5f;
+    }
+};
+#endif
@@ -0,0 +1,358 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// one level of an 8 bit per channel image
+struct MipLevel {
+    int width = 0;
+    int height = 0;
+    vector<unsigned char> pixels;
+};
+
+enum MipFilter {
+    MIP_BOX,    // 2x2 average, what glGenerateMipmap does on most drivers
+    MIP_KAISER  // Kaiser windowed sinc, sharper minification without the aliasing of a box
+};
+
+struct MipSettings {
+    MipFilter filter = MIP_KAISER;
+    // the color channels hold sRGB encoded values (albedo), filter them in linear space
+    bool srgb = false;
+    // for images with alpha: scale each level's alpha so the fraction of texels at or above alphaCutoff stays what
+    // it is in the base level, otherwise alpha tested detail thins out and vanishes with distance
+    bool preserveAlphaCoverage = true;
+    float alphaCutoff = 0.5f;
+};
+
+// builds mip chains on the cpu, so textures don't depend on glGenerateMipmap at load time and look the same on
+// every driver. filters are separable: a vertical pass over whole rows (vectorized across the row), then a
+// horizontal pass per texel (vectorized across the channels of RGBA images). rows are converted to float once
+// through lookup tables, so sRGB decoding costs no pow per texel.
+class MipChain
+{
+public:
+    static int LevelCount(int width, int height)
+    {
+        int levels = 1;
+        while(width > 1 || height > 1)
+        {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+            levels++;
+        }
+        return levels;
+    }
+
+    // the full chain down to 1x1, level 0 being a copy of the source. every level is filtered from the one above,
+    // output rows are split into bands over the pool when one is given.
+    static vector<MipLevel> Build(const unsigned char *pixels, int width, int height, int components,
+                                  const MipSettings &settings = MipSettings(), ThreadPool *pool = nullptr)
+    {
+        vector<MipLevel> levels(1);
+        levels[0].width = width;
+        levels[0].height = height;
+        levels[0].pixels.assign(pixels, pixels + size_t(width) * height * components);
+
+        bool coverage = settings.preserveAlphaCoverage && components == 4 && hasAlpha(levels[0]);
+        float targetCoverage = coverage ? alphaCoverage(levels[0], settings.alphaCutoff) : 0.0f;
+        // all or nothing passing the cutoff (uniformly translucent images) leaves no edge to preserve
+        coverage = coverage && targetCoverage > 0.0f && targetCoverage < 1.0f;
+
+        while(levels.back().width > 1 || levels.back().height > 1)
+        {
+            MipLevel next = Downsample(levels.back(), components, settings, pool);
+            if(coverage)
+                scaleAlphaToCoverage(next, settings.alphaCutoff, targetCoverage);
+            levels.push_back(std::move(next));
+        }
+        return levels;
+    }
+
+    // one level down, halving each dimension that is above 1
+    static MipLevel Downsample(const MipLevel &src, int components, const MipSettings &settings = MipSettings(), ThreadPool *pool = nullptr)
+    {
+        MipLevel dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.pixels.resize(size_t(dst.width) * dst.height * components);
+
+        Kernel horizontal = makeKernel(src.width, dst.width, settings.filter);
+        Kernel vertical = makeKernel(src.height, dst.height, settings.filter);
+        // channels stored as sRGB: the first three of RGB(A) images when asked for, alpha is always linear
+        bool srgbChannel[4] = {};
+        for(int c = 0; c < components && c < 3; c++)
+            srgbChannel[c] = settings.srgb && components >= 3;
+
+        int bands = 1;
+        if(pool && size_t(dst.width) * dst.height >= 64 * 64)
+            bands = std::min(dst.height, (int)pool->Size() * 4);
+        auto filterBand = [&](size_t band) {
+            int begin = int(size_t(dst.height) * band / bands);
+            int end = int(size_t(dst.height) * (band + 1) / bands);
+            filterRows(src, dst, components, horizontal, vertical, srgbChannel, begin, end);
+        };
+        if(bands > 1)
+            pool->ParallelFor(0, bands, filterBand);
+        else
+            filterBand(0);
+        return dst;
+    }
+
+private:
+    // weights for each output coordinate of one axis, taps are consecutive (edge clamped) source coordinates
+    struct Kernel {
+        vector<int> first;
+        vector<int> count;
+        vector<size_t> offset;
+        vector<float> weights;
+        int maxTaps = 0;
+    };
+
+    static bool hasAlpha(const MipLevel &level)
+    {
+        for(size_t i = 3; i < level.pixels.size(); i += 4)
+            if(level.pixels[i] != 255)
+                return true;
+        return false;
+    }
+
+    // modified Bessel function of the first kind, order 0
+    static double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for(int k = 1; k < 32; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+            if(term < sum * 1e-12)
+                break;
+        }
+        return sum;
+    }
+
+    // t is the distance from the output texel center, in output texels
+    static double filterWeight(MipFilter filter, double t)
+    {
+        t = std::fabs(t);
+        if(filter == MIP_BOX)
+            return t <= 0.5 ? 1.0 : 0.0;
+        const double width = 3.0, alpha = 4.0;
+        if(t >= width)
+            return 0.0;
+        const double pi = 3.14159265358979323846;
+        double sinc = t < 1e-6 ? 1.0 : std::sin(pi * t) / (pi * t);
+        double r = t / width;
+        return sinc * besselI0(alpha * std::sqrt(1.0 - r * r)) / besselI0(alpha);
+    }
+
+    static Kernel makeKernel(int srcSize, int dstSize, MipFilter filter)
+    {
+        Kernel kernel;
+        double scale = double(srcSize) / dstSize;
+        double support = (filter == MIP_BOX ? 0.5 : 3.0) * scale;
+        for(int x = 0; x < dstSize; x++)
+        {
+            double center = (x + 0.5) * scale - 0.5;
+            int first = (int)std::ceil(center - support);
+            int last = (int)std::floor(center + support);
+            vector<float> taps;
+            double sum = 0.0;
+            for(int i = first; i <= last; i++)
+            {
+                double w = scale > 1.0 ? filterWeight(filter, (i - center) / scale) : (i == x ? 1.0 : 0.0);
+                taps.push_back((float)w);
+                sum += w;
+            }
+            // trim zero weights at both ends (box edges, kaiser zero crossings at the support boundary)
+            size_t lo = 0, hi = taps.size();
+            while(lo < hi && taps[lo] == 0.0f)
+                lo++;
+            while(hi > lo && taps[hi - 1] == 0.0f)
+                hi--;
+            kernel.first.push_back(first + (int)lo);
+            kernel.count.push_back(int(hi - lo));
+            kernel.offset.push_back(kernel.weights.size());
+            for(size_t i = lo; i < hi; i++)
+                kernel.weights.push_back(float(taps[i] / sum));
+            kernel.maxTaps = std::max(kernel.maxTaps, int(hi - lo));
+        }
+        return kernel;
+    }
+
+    static const float *byteToFloat(bool srgb)
+    {
+        static const vector<float> linear = []() {
+            vector<float> table(256);
+            for(int i = 0; i < 256; i++)
+                table[i] = i / 255.0f;
+            return table;
+        }();
+        static const vector<float> fromSrgb = []() {
+            vector<float> table(256);
+            for(int i = 0; i < 256; i++)
+            {
+                double v = i / 255.0;
+                table[i] = (float)(v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4));
+            }
+            return table;
+        }();
+        return srgb ? fromSrgb.data() : linear.data();
+    }
+
+    // linear [0, 1] to sRGB bytes, 4096 steps are fine enough that neighboring steps never skip a byte value
+    static const unsigned char *linearToSrgb()
+    {
+        static const vector<unsigned char> table = []() {
+            vector<unsigned char> result(4096);
+            for(int i = 0; i < 4096; i++)
+            {
+                double v = i / 4095.0;
+                double s = v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+                result[i] = (unsigned char)std::min(255.0, std::floor(s * 255.0 + 0.5));
+            }
+            return result;
+        }();
+        return table.data();
+    }
+
+    static unsigned char quantize(float v, bool srgb)
+    {
+        v = std::min(std::max(v, 0.0f), 1.0f);
+        if(srgb)
+            return linearToSrgb()[(int)(v * 4095.0f + 0.5f)];
+        return (unsigned char)(v * 255.0f + 0.5f);
+    }
+
+    // accumulate += weight * row, over n floats
+    static void accumulateRow(float *accumulator, const float *row, float weight, size_t n)
+    {
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128 w = _mm_set1_ps(weight);
+        for(; i + 4 <= n; i += 4)
+            _mm_storeu_ps(accumulator + i, _mm_add_ps(_mm_loadu_ps(accumulator + i), _mm_mul_ps(w, _mm_loadu_ps(row + i))));
+#endif
+        for(; i < n; i++)
+            accumulator[i] += weight * row[i];
+    }
+
+    static void filterRows(const MipLevel &src, MipLevel &dst, int components, const Kernel &horizontal, const Kernel &vertical,
+                           const bool srgbChannel[4], int begin, int end)
+    {
+        size_t rowFloats = size_t(src.width) * components;
+        const float *tables[4];
+        for(int c = 0; c < 4; c++)
+            tables[c] = byteToFloat(srgbChannel[c]);
+
+        // source rows converted to float, reused by the overlapping taps of neighboring output rows
+        int ringSize = vertical.maxTaps + 2;
+        vector<float> ring(size_t(ringSize) * rowFloats);
+        vector<int> ringRow(ringSize, -1);
+        auto sourceRow = [&](int y) -> const float* {
+            y = std::min(std::max(y, 0), src.height - 1);
+            int slot = y % ringSize;
+            float *row = &ring[size_t(slot) * rowFloats];
+            if(ringRow[slot] != y)
+            {
+                const unsigned char *bytes = &src.pixels[size_t(y) * rowFloats];
+                for(size_t i = 0; i < rowFloats; i++)
+                    row[i] = tables[i % components][bytes[i]];
+                ringRow[slot] = y;
+            }
+            return row;
+        };
+
+        vector<float> column(rowFloats);
+        for(int y = begin; y < end; y++)
+        {
+            // vertical pass: one float row, the weighted sum of the source rows under the kernel
+            std::fill(column.begin(), column.end(), 0.0f);
+            const float *vw = &vertical.weights[vertical.offset[y]];
+            for(int k = 0; k < vertical.count[y]; k++)
+                accumulateRow(column.data(), sourceRow(vertical.first[y] + k), vw[k], rowFloats);
+
+            // horizontal pass
+            unsigned char *out = &dst.pixels[size_t(y) * dst.width * components];
+            for(int x = 0; x < dst.width; x++)
+            {
+                const float *hw = &horizontal.weights[horizontal.offset[x]];
+                float texel[4] = {};
+#if defined(__SSE2__)
+                if(components == 4)
+                {
+                    __m128 sum = _mm_setzero_ps();
+                    for(int k = 0; k < horizontal.count[x]; k++)
+                    {
+                        int sx = std::min(std::max(horizontal.first[x] + k, 0), src.width - 1);
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(hw[k]), _mm_loadu_ps(&column[size_t(sx) * 4])));
+                    }
+                    _mm_storeu_ps(texel, sum);
+                }
+                else
+#endif
+                for(int k = 0; k < horizontal.count[x]; k++)
+                {
+                    int sx = std::min(std::max(horizontal.first[x] + k, 0), src.width - 1);
+                    for(int c = 0; c < components; c++)
+                        texel[c] += hw[k] * column[size_t(sx) * components + c];
+                }
+                for(int c = 0; c < components; c++)
+                    out[x * components + c] = quantize(texel[c], srgbChannel[c]);
+            }
+        }
+    }
+
+    // fraction of texels whose alpha reaches the cutoff
+    static float alphaCoverage(const MipLevel &level, float cutoff)
+    {
+        size_t passed = 0, texels = size_t(level.width) * level.height;
+        for(size_t i = 0; i < texels; i++)
+            if(level.pixels[i * 4 + 3] >= cutoff * 255.0f)
+                passed++;
+        return float(passed) / texels;
+    }
+
+    // binary search over an alpha scale that brings the level's coverage closest to the target, on a histogram so
+    // each step is independent of the level size
+    static void scaleAlphaToCoverage(MipLevel &level, float cutoff, float target)
+    {
+        size_t texels = size_t(level.width) * level.height;
+        size_t histogram[256] = {};
+        for(size_t i = 0; i < texels; i++)
+            histogram[level.pixels[i * 4 + 3]]++;
+        auto coverageAt = [&](float scale) {
+            size_t passed = 0;
+            for(int a = 0; a < 256; a++)
+                if(a * scale >= cutoff * 255.0f)
+                    passed += histogram[a];
+            return float(passed) / texels;
+        };
+
+        float lo = 0.0f, hi = 4.0f, scale = 1.0f;
+        for(int step = 0; step < 16; step++)
+        {
+            scale = 0.5f * (lo + hi);
+            if(coverageAt(scale) < target)
+                lo = scale;
+            else
+                hi = scale;
+        }
+        scale = hi;
+        if(std::fabs(coverageAt(scale) - target) >= std::fabs(coverageAt(1.0f) - target))
+            return;
+        for(size_t i = 0; i < texels; i++)
+            level.pixels[i * 4 + 3] = (unsigned char)std::min(255.0f, level.pixels[i * 4 + 3] * scale + 0.5f);
+    }
+};
+#endif
@@ -11,13 +11,26 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/obj_parser.h>
+#include <learnopengl/render_queue.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_atlas.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/trace.h>
 
+#include <cmath>
 #include <string>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
@@ -29,51 +42,458 @@ class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// textures this model holds a TextureCache reference to, each path once.
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    string textureNamePrefix;
+    // layout meshes are uploaded in, has to be chosen before loading
+    VertexFormat vertexFormat;
+    // keep the cpu copy of the meshes' vertices and indices after upload. off by default: drawing only needs the
+    // gpu buffers and the bounds each Mesh keeps, so MakeResident frees them.
+    bool keepCpuGeometry;
+
+    struct VertexStats {
+        size_t vertices = 0;
+        size_t bytes = 0;           // gpu vertex buffer in vertexFormat
+        size_t floatBytes = 0;      // the same vertices in the full float layout
+        size_t indexBytes = 0;      // gpu index buffer, 16 bit where meshes allow it
+        size_t indexBytes32 = 0;    // the same indices all 32 bit
+        size_t cpuBytes = 0;        // cpu copy of the geometry still held
+        size_t cpuBytesReleased = 0;    // what the released cpu copies took, full resolution vertices and indices
+    };
+
+    // what Enqueue submitted since the last ResetDrawStats, summed over all models
+    struct DrawStats {
+        size_t draws = 0;
+        size_t triangles = 0;
+        size_t lodDraws[MeshSimplifier::MAX_LODS] = {};  // draws per level of detail
+    };
+
+    // post processing requested from assimp. part of the mesh cache key, so changing it invalidates cached meshes.
+    static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+    // empty model, streamed in later through AddMesh (see ModelLoader). until it is resident Enqueue adds the
+    // placeholder box, if one was set.
+    Model() : gammaCorrection(false), vertexFormat(VERTEX_FLOAT), keepCpuGeometry(false), resident(false) {}
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, VertexFormat format = VERTEX_FLOAT)
+        : gammaCorrection(gamma), vertexFormat(format), keepCpuGeometry(false), resident(false)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // textures are shared through the TextureCache, the references taken by this model are dropped here
+    ~Model()
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        releaseTextures();
     }
 
+    // move-only: the texture references and gpu buffers belong to exactly one model. a model the ModelLoader is
+    // still streaming into must not be moved, the loader holds on to its address.
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model&&) = default;
+
+    Model& operator=(Model &&other)
+    {
+        if(this == &other)
+            return *this;
+        releaseTextures();
+        textures_loaded = std::move(other.textures_loaded);
+        other.textures_loaded.clear();
+        meshes = std::move(other.meshes);
+        directory = std::move(other.directory);
+        gammaCorrection = other.gammaCorrection;
+        textureNamePrefix = std::move(other.textureNamePrefix);
+        vertexFormat = other.vertexFormat;
+        keepCpuGeometry = other.keepCpuGeometry;
+        resident = other.resident;
+        geometry = std::move(other.geometry);
+        placeholder = std::move(other.placeholder);
+        placeholderGeometry = std::move(other.placeholderGeometry);
+        loadedByPath = std::move(other.loadedByPath);
+        return *this;
+    }
+
+    // adds the model placed by transform to a pass of queue instead of drawing it: one item per mesh, at the level of
+    // detail the current LodView asks for and with the program select picks for it. a model still streaming in adds
+    // its placeholder. meshes with a blended material go to the transparent pass instead of the opaque one. the
+    // meshes are counted as drawn here, the binds they cost are counted by the queue.
+    void Enqueue(RenderQueue &queue, RenderPass pass, const glm::mat4 &transform, float shininess,
+                 const function<Shader&(const Mesh&)> &select)
+    {
+        DrawStats &frame = stats();
+        if(!resident)
+        {
+            if(placeholder)
+            {
+                queue.AddMesh(pass, select(*placeholder), *placeholder, 0, *placeholderGeometry, transform, shininess);
+                frame.draws++;
+                frame.triangles += placeholder->range.indexCount / 3;
+                frame.lodDraws[0]++;
+            }
+            return;
+        }
+        for(Mesh &mesh : meshes)
+        {
+            size_t lod = selectLod(mesh, &transform);
+            RenderPass meshPass = pass == RENDER_PASS_OPAQUE && mesh.material.blended ? RENDER_PASS_TRANSPARENT : pass;
+            queue.AddMesh(meshPass, select(mesh), mesh, lod, *geometry, transform, shininess);
+            frame.draws++;
+            frame.triangles += mesh.lods[lod].range.indexCount / 3;
+            frame.lodDraws[lod]++;
+        }
+    }
+
+    // camera the levels of detail are chosen for, until the next SetLodView. fovY in radians, viewportHeight in
+    // pixels; a mesh is drawn at the coarsest level whose error covers at most maxPixelError pixels.
+    static void SetLodView(const glm::vec3 &position, float fovY, float viewportHeight, float maxPixelError)
+    {
+        LodView &view = lodView();
+        view.position = position;
+        view.pixelsAtUnitDistance = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+        view.maxPixelError = maxPixelError;
+    }
+
+    // full resolution for everything again
+    static void ClearLodView() { lodView() = LodView(); }
+
+    static const DrawStats &GetDrawStats() { return stats(); }
+
+    // starts a new count, once per frame
+    static void ResetDrawStats() { stats() = DrawStats(); }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
+        textureNamePrefix = prefix;
         for (Mesh& mesh: meshes) {
             mesh.glslIdentifierPrefix = prefix;
         }
+        if (placeholder)
+            placeholder->glslIdentifierPrefix = prefix;
     }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+
+    bool IsResident() const { return resident; }
+
+    VertexStats GetVertexStats() const
+    {
+        VertexStats stats;
+        for(const Mesh &mesh : meshes)
+        {
+            stats.vertices += mesh.VertexCount();
+            stats.bytes += mesh.VertexBytes();
+            stats.floatBytes += mesh.VertexCount() * sizeof(Vertex);
+            stats.indexBytes += mesh.IndexBytes();
+            for(const Mesh::Lod &lod : mesh.lods)
+                stats.indexBytes32 += lod.range.indexCount * sizeof(unsigned int);
+            stats.cpuBytes += mesh.CpuGeometryBytes();
+            if(mesh.CpuGeometryBytes() == 0)
+                stats.cpuBytesReleased += mesh.VertexCount() * sizeof(Vertex) + mesh.range.indexCount * sizeof(unsigned int);
+        }
+        return stats;
+    }
+
+    // flat shaded grey box spanning the given bounds, drawn until the real meshes are resident
+    void SetPlaceholder(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+    {
+        static const glm::vec3 normals[6] = {
+            glm::vec3( 1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f, 0.0f),
+            glm::vec3( 0.0f,-1.0f, 0.0f), glm::vec3( 0.0f, 0.0f, 1.0f), glm::vec3(0.0f,  0.0f,-1.0f)
+        };
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        for(int face = 0; face < 6; face++)
+        {
+            // two axes spanning the face, ordered so the quad winds counter-clockwise seen from outside
+            glm::vec3 n = normals[face];
+            glm::vec3 u = glm::vec3(n.y + n.z != 0.0f ? 1.0f : 0.0f, n.x != 0.0f ? 1.0f : 0.0f, 0.0f);
+            glm::vec3 v = glm::cross(n, u);
+            unsigned int base = (unsigned int)vertices.size();
+            const float corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+            for(int c = 0; c < 4; c++)
+            {
+                Vertex vertex;
+                vertex.Position = center + (n + u * corners[c][0] + v * corners[c][1]) * extent;
+                vertex.Normal = n;
+                vertex.TexCoords = glm::vec2(corners[c][0] * 0.5f + 0.5f, corners[c][1] * 0.5f + 0.5f);
+                vertex.Tangent = u;
+                vertex.Bitangent = v;
+                vertices.push_back(vertex);
+            }
+            unsigned int quad[6] = {base, base + 1, base + 2, base + 2, base + 3, base};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+        vector<Texture> textures(2);
+        textures[0].id = textures[1].id = placeholderTexture();
+        textures[0].type = "texture_diffuse";
+        textures[1].type = "texture_specular";
+        placeholderGeometry.reset(new GeometryArena(VERTEX_FLOAT));
+        placeholder.reset(new Mesh(std::move(vertices), std::move(indices), std::move(textures), *placeholderGeometry));
+        placeholder->glslIdentifierPrefix = textureNamePrefix;
+        placeholderGeometry->Upload();
+        placeholder->ReleaseGeometry();
+    }
+
+    // how the mip chain of a material texture is filtered: diffuse maps hold sRGB colors, everything else is data
+    static MipSettings TextureMipSettings(string const &type)
+    {
+        MipSettings settings;
+        settings.srgb = type == "texture_diffuse";
+        return settings;
+    }
+
+    // whether .obj files are read by ObjParser (the default) instead of assimp. the two imports are cached apart,
+    // so switching re-imports once.
+    static void SetNativeObjParser(bool enabled) { nativeObjParser() = enabled; }
+
+    // cpu side of loading: reads the binary mesh cache when it matches the source file, otherwise imports the file
+    // (with ObjParser or assimp) and rewrites the cache. doesn't touch any gl state. the pool, if given, parses
+    // large obj files in parallel.
+    static bool Import(string const &path, vector<MeshData> &meshes, bool *fromCache = nullptr, ThreadPool *pool = nullptr)
+    {
+        if(fromCache)
+            *fromCache = false;
+        bool native = nativeObjParser() && ObjParser::IsObj(path);
+        unsigned int flags = native ? ObjParser::CACHE_FLAGS : IMPORT_FLAGS;
+        uint64_t sourceKey;
+        // the cached meshes point into atlas pages written by the same import, which must still be there
+        {
+            TraceZone zone("mesh cache load", path);
+            sourceKey = MeshCache::SourceKey(path);
+            if(MeshCache::Load(path, flags, sourceKey, meshes) && TextureAtlas::Current(path, meshes, sourceKey))
+            {
+                if(fromCache)
+                    *fromCache = true;
+                return true;
+            }
+        }
+        if(!(native ? ImportWithObjParser(path, meshes, sourceKey, pool) : ImportWithAssimp(path, meshes, sourceKey)))
+            return false;
+        TraceZone zone("mesh cache store", path);
+        if(!MeshCache::Store(path, flags, sourceKey, meshes))
+            cout << "WARNING::MESH_CACHE:: could not write " << MeshCache::PathFor(path) << endl;
+        return true;
+    }
+
+    // reads a Wavefront .obj with ObjParser, bypassing the mesh cache. sourceKey (MeshCache::SourceKey of path) goes
+    // into the atlas pages.
+    static bool ImportWithObjParser(string const &path, vector<MeshData> &meshes, uint64_t sourceKey, ThreadPool *pool = nullptr)
+    {
+        {
+            TraceZone zone("obj parse", path);
+            if(!ObjParser::Parse(path, meshes, pool))
+                return false;
+        }
+        optimizeMeshes(path, meshes);
+        packTextures(path, meshes, sourceKey);
+        return true;
+    }
+
+    // reads a model with supported ASSIMP extensions from file, bypassing the mesh cache. sourceKey as above.
+    static bool ImportWithAssimp(string const &path, vector<MeshData> &meshes, uint64_t sourceKey)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = nullptr;
+        {
+            TraceZone zone("assimp read", path);
+            scene = importer.ReadFile(path, IMPORT_FLAGS);
+        }
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return false;
+        }
+        meshes.clear();
+        // process ASSIMP's root node recursively
+        processNode(scene->mRootNode, scene, meshes);
+        optimizeMeshes(path, meshes);
+        packTextures(path, meshes, sourceKey);
+        return true;
+    }
+
+    // uploads imported mesh data and makes the model resident, must run on the thread owning the gl context.
+    // textures already present in textures_loaded are reused, missing ones are loaded synchronously. the geometry is
+    // moved out of data, see AddMesh.
+    void Build(string const &modelDirectory, vector<MeshData> &data)
+    {
+        directory = modelDirectory;
+        meshes.reserve(meshes.size() + data.size());
+        for(MeshData &mesh : data)
+            AddMesh(mesh);
+        MakeResident();
+    }
+
+    // adds a single mesh to the model's geometry arena, which is uploaded in one go by MakeResident. nothing is drawn
+    // before that, so a model can be streamed in over several frames. vertices and indices are moved into the Mesh,
+    // mesh is left without them.
+    void AddMesh(MeshData &mesh)
+    {
+        if(!geometry)
+            geometry.reset(new GeometryArena(vertexFormat));
+        meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), loadMaterialTextures(mesh.textures), *geometry,
+                            mesh.colors);
+        meshes.back().glslIdentifierPrefix = textureNamePrefix;
+        Material &material = meshes.back().material;
+        if(material.HasColor(TEXTURE_SPECULAR))
+            material.blended = material.colors[TEXTURE_SPECULAR].a < 1.0f;
+        else
+            material.blended = TextureCache::Instance().HasAlpha(material.textures[TEXTURE_SPECULAR]);
+        for(const MeshLod &lod : mesh.lods)
+            meshes.back().AddLod(lod.indices, lod.error, *geometry);
+    }
+
+    void MakeResident()
+    {
+        if(!geometry)
+            geometry.reset(new GeometryArena(vertexFormat));
+        geometry->Upload();
+        if(!keepCpuGeometry)
+            for(Mesh &mesh : meshes)
+                mesh.ReleaseGeometry();
+        resident = true;
+        placeholder.reset();
+        placeholderGeometry.reset();
+    }
+
+    // registers a texture the caller already acquired from the TextureCache for this model. the model takes over
+    // that reference; meshes referencing the same path will use it instead of loading the file again.
+    void AddLoadedTexture(const Texture &texture)
+    {
+        string key = TextureCache::NormalizePath(directory + '/' + texture.path);
+        if(!loadedByPath.emplace(key, textures_loaded.size()).second)
+        {
+            TextureCache::Instance().Release(texture.id);
             return;
         }
+        textures_loaded.push_back(texture);
+    }
+private:
+    bool resident;
+    // one vertex and one index buffer for all meshes, created with the first mesh in vertexFormat
+    unique_ptr<GeometryArena> geometry;
+    unique_ptr<Mesh> placeholder;
+    unique_ptr<GeometryArena> placeholderGeometry;
+    // normalized path -> index into textures_loaded
+    unordered_map<string, size_t> loadedByPath;
+
+    void releaseTextures()
+    {
+        for(const Texture &texture : textures_loaded)
+            TextureCache::Instance().Release(texture.id);
+        textures_loaded.clear();
+    }
+
+    static bool &nativeObjParser()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+
+    static DrawStats &stats()
+    {
+        static DrawStats frame;
+        return frame;
+    }
+
+    struct LodView {
+        glm::vec3 position = glm::vec3(0.0f);
+        // projected size of one unit at distance one, 0 while no view is set
+        float pixelsAtUnitDistance = 0.0f;
+        float maxPixelError = 1.0f;
+    };
+
+    static LodView &lodView()
+    {
+        static LodView view;
+        return view;
+    }
+
+    // level of detail of a mesh seen through the current LodView, from its bounding sphere moved by transform
+    static size_t selectLod(const Mesh &mesh, const glm::mat4 *transform)
+    {
+        const LodView &view = lodView();
+        if(!transform || view.pixelsAtUnitDistance <= 0.0f || mesh.lods.size() == 1)
+            return 0;
+        const glm::mat4 &m = *transform;
+        float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+        glm::vec3 center = glm::vec3(m * glm::vec4(mesh.boundsCenter, 1.0f));
+        // distance to the nearest point of the sphere, inside it everything is drawn at full resolution
+        float distance = glm::length(center - view.position) - mesh.boundsRadius * scale;
+        if(distance <= 0.0f)
+            return 0;
+        return mesh.SelectLod(view.pixelsAtUnitDistance * scale / distance, view.maxPixelError);
+    }
+
+    // 1x1 mid grey texture shared by all placeholders, bound as both the diffuse and the specular map
+    static unsigned int placeholderTexture()
+    {
+        static unsigned int textureID = 0;
+        if(textureID == 0)
+        {
+            const unsigned char grey[4] = {160, 160, 160, 255};
+            glGenTextures(1, &textureID);
+            GLState::BindTexture(GL_TEXTURE_2D, textureID);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        return textureID;
+    }
+
+    // loads the model's meshes (from the mesh cache or through assimp) and uploads them together with their textures.
+    void loadModel(string const &path)
+    {
+        vector<MeshData> data;
+        if(!Import(path, data))
+            return;
         // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        Build(path.substr(0, path.find_last_of('/')), data);
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    // welds and reorders the imported meshes for the gpu caches (see MeshOptimizer) and builds their levels of
+    // detail (see MeshSimplifier), logging what it gained. runs on imports only, the mesh cache stores the result.
+    static void optimizeMeshes(string const &path, vector<MeshData> &meshes)
+    {
+        TraceZone zone("optimize meshes", path);
+        ostringstream log;
+        log << "Optimized " << path << ":" << '\n';
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            MeshOptimizer::Stats before, after;
+            MeshOptimizer::Optimize(meshes[i], &before, &after);
+            log << "  mesh " << i << ": vertices " << before.vertices << " -> " << after.vertices
+                << ", triangles " << before.triangles << " -> " << after.triangles
+                << ", ACMR " << before.acmr << " -> " << after.acmr
+                << ", ATVR " << before.atvr << " -> " << after.atvr;
+            MeshSimplifier::GenerateLods(meshes[i]);
+            log << ", LOD triangles " << meshes[i].indices.size() / 3;
+            for(const MeshLod &lod : meshes[i].lods)
+                log << " / " << lod.indices.size() / 3;
+            log << '\n';
+        }
+        // one write, imports run on several threads at once
+        cout << log.str() << flush;
+    }
+
+    // turns single color textures into constants and packs small ones into atlas pages (see TextureAtlas)
+    static void packTextures(string const &path, vector<MeshData> &meshes, uint64_t sourceKey)
+    {
+        TraceZone zone("pack textures", path);
+        TextureAtlas::Stats stats = TextureAtlas::Build(path, meshes, sourceKey);
+        ostringstream log;
+        log << "Packed textures of " << path << ": " << stats.textures << " textures, " << stats.constants
+            << " made constant colors, " << stats.packed << " packed into " << stats.pages << " atlas pages, "
+            << stats.textures - stats.constants - stats.packed + stats.pages << " left to bind" << '\n';
+        cout << log.str() << flush;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, vector<MeshData> &meshes)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -86,17 +506,20 @@ private:
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vector<Texture> &textures = data.textures;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(size_t(mesh->mNumFaces) * 3);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -164,53 +587,68 @@ private:
 
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<Texture> diffuseMaps = collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        vector<Texture> specularMaps = collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        std::vector<Texture> normalMaps = collectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        std::vector<Texture> heightMaps = collectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects the texture references of the given type from an assimp material. only type and path are filled in.
+    static vector<Texture> collectMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+        }
+        return textures;
+    }
+
+    // resolves the texture references of a mesh. textures already held by this model are reused directly, others
+    // come from the process wide TextureCache, which only decodes and uploads images it hasn't seen before.
+    vector<Texture> loadMaterialTextures(const vector<Texture> &references)
+    {
+        vector<Texture> textures;
+        for(const Texture &reference : references)
+        {
+            string key = TextureCache::NormalizePath(directory + '/' + reference.path);
+            auto it = loadedByPath.find(key);
+            if(it != loadedByPath.end())
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
+                textures.push_back(textures_loaded[it->second]);
+                continue;
             }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+
+            TextureCache &cache = TextureCache::Instance();
+            Texture texture = reference;
+            texture.id = cache.AcquireByPath(key);
+            if(texture.id == 0)
+            {
+                KtxTexture loaded;
+                if(!TextureLoader::Load(key, false, loaded, TextureMipSettings(reference.type)))
+                    std::cout << "Texture failed to load at path: " << reference.path << std::endl;
+                texture.id = cache.AcquireLoaded(key, loaded, TextureCache::ContentKey(loaded, gammaCorrection));
             }
+            textures.push_back(texture);
+            loadedByPath[key] = textures_loaded.size();
+            textures_loaded.push_back(texture);
         }
         return textures;
     }
@@ -222,38 +660,11 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
+    MipSettings mips;
+    mips.srgb = gamma;
+    KtxTexture texture;
+    if (!TextureLoader::Load(filename, false, texture, mips))
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    return TextureFromKtx(texture);
 }
 #endif
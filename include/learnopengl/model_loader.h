@@ -0,0 +1,369 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <learnopengl/image.h>
+#include <learnopengl/model.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+// streams models in the background. model imports (mesh cache, ObjParser or assimp) and texture loads (decode and block
+// compression, or the compressed texture cache) run on a thread pool, the thread owning the gl context only does
+// the uploads, either all at once (Finish) or a time slice per frame
+// (Update) while the render loop keeps drawing placeholders. decoded pixels waiting for upload are kept under a
+// byte budget, so decoding never runs arbitrarily far ahead of the uploads.
+class ModelLoader
+{
+public:
+    static const size_t DEFAULT_DECODE_BUDGET = 256u * 1024u * 1024u;
+
+    struct Stats {
+        unsigned int modelsLoaded = 0;
+        unsigned int texturesDecoded = 0;
+        size_t decodedBytes = 0;
+        size_t peakDecodedBytes = 0;
+        unsigned int threads = 0;
+    };
+
+    // 0 threads means one per hardware thread
+    explicit ModelLoader(unsigned int threads = 0, size_t decodeBudgetBytes = DEFAULT_DECODE_BUDGET)
+        : budget(decodeBudgetBytes), pool(threads)
+    {
+        stats.threads = pool.Size();
+    }
+
+    // whatever is still queued is dropped: jobs not yet started return right away, decodes waiting for budget that
+    // the context thread will never release again give up, and the pool joins its workers
+    ~ModelLoader()
+    {
+        cancelled = true;
+        budget.Cancel();
+    }
+
+    // queues a model for loading into target. target has to stay alive until it is resident, or until the loader
+    // is no longer updated.
+    void Load(Model &target, string const &path)
+    {
+        jobs.emplace_back(new Job());
+        Job *job = jobs.back().get();
+        job->target = &target;
+        job->gamma = target.gammaCorrection;
+        job->path = path;
+        job->directory = path.substr(0, path.find_last_of('/'));
+        remaining++;
+        pool.Submit([this, job]() { importJob(job); });
+    }
+
+    // does gl upload work on the calling thread, which has to own the gl context, for roughly the given time and
+    // returns. at least one upload is done per call so loading always progresses. models become resident (and stop
+    // drawing their placeholder) once all their meshes and textures are uploaded. returns true when nothing is left.
+    bool Update(double budgetMilliseconds)
+    {
+        auto start = chrono::steady_clock::now();
+        while(remaining > 0)
+        {
+            if(!uploadStep())
+                break;
+            if(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() >= budgetMilliseconds)
+                break;
+        }
+        return Done();
+    }
+
+    // blocks until every queued model is resident, doing all uploads on the calling thread
+    void Finish()
+    {
+        while(remaining > 0)
+        {
+            if(!uploadStep())
+            {
+                unique_lock<mutex> lock(eventMutex);
+                eventReady.wait(lock, [this]() { return !events.empty(); });
+            }
+        }
+    }
+
+    bool Done() const { return remaining == 0; }
+
+    const Stats &GetStats() const { return stats; }
+
+private:
+    struct Job {
+        // only touched on the context thread, workers read the copied settings below
+        Model *target = nullptr;
+        bool gamma = false;
+        string path;
+        string directory;
+        vector<MeshData> meshes;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        unsigned int texturesPending = 0;
+        size_t meshesAdded = 0;
+        bool imported = false;
+        bool failed = false;
+    };
+
+    struct Event {
+        enum Type { IMPORTED, TEXTURE_DECODED } type = IMPORTED;
+        Job *job = nullptr;
+        unsigned int textureCount = 0;
+        string textureType;
+        string texturePath;
+        // normalized full path, the TextureCache key
+        string cacheKey;
+        // already resident in the TextureCache when the worker checked, nothing was loaded
+        bool cached = false;
+        KtxTexture texture;
+        uint64_t contentKey = 0;
+        size_t reservedBytes = 0;
+    };
+
+    // counting semaphore over bytes of decoded pixels. a request larger than the whole budget is let through
+    // once nothing else is reserved, so oversized images still load, one at a time.
+    class ByteBudget
+    {
+    public:
+        explicit ByteBudget(size_t limit) : limit(limit) {}
+
+        // false, with nothing reserved, once the budget is cancelled
+        bool Acquire(size_t bytes)
+        {
+            unique_lock<mutex> lock(budgetMutex);
+            released.wait(lock, [&]() { return cancelled || inUse == 0 || inUse + bytes <= limit; });
+            if(cancelled)
+                return false;
+            inUse += bytes;
+            total += bytes;
+            peak = std::max(peak, inUse);
+            return true;
+        }
+
+        // wakes every waiting Acquire and fails all later ones
+        void Cancel()
+        {
+            {
+                lock_guard<mutex> lock(budgetMutex);
+                cancelled = true;
+            }
+            released.notify_all();
+        }
+
+        void Release(size_t bytes)
+        {
+            {
+                lock_guard<mutex> lock(budgetMutex);
+                inUse -= bytes;
+            }
+            released.notify_all();
+        }
+
+        size_t Peak()
+        {
+            lock_guard<mutex> lock(budgetMutex);
+            return peak;
+        }
+
+        size_t Total()
+        {
+            lock_guard<mutex> lock(budgetMutex);
+            return total;
+        }
+
+    private:
+        size_t limit;
+        size_t inUse = 0;
+        size_t peak = 0;
+        size_t total = 0;
+        bool cancelled = false;
+        mutex budgetMutex;
+        condition_variable released;
+    };
+
+    vector<unique_ptr<Job>> jobs;
+    // models imported with all textures uploaded, waiting for their meshes to be added
+    deque<Job*> building;
+    size_t remaining = 0;
+    mutex eventMutex;
+    condition_variable eventReady;
+    deque<Event> events;
+    ByteBudget budget;
+    Stats stats;
+    // set by the destructor, queued jobs check it before starting any work
+    atomic<bool> cancelled{false};
+    // declared last so the workers are joined before anything they reference is destroyed
+    ThreadPool pool;
+
+    void post(Event event)
+    {
+        {
+            lock_guard<mutex> lock(eventMutex);
+            events.push_back(std::move(event));
+        }
+        eventReady.notify_one();
+    }
+
+    // a single unit of upload work: one mesh of a model being built, or one event from the workers.
+    // returns false if there was nothing to do right now.
+    bool uploadStep()
+    {
+        if(!building.empty())
+        {
+            TraceZone zone("add mesh");
+            Job *job = building.front();
+            if(job->meshesAdded < job->meshes.size())
+                job->target->AddMesh(job->meshes[job->meshesAdded++]);
+            if(job->meshesAdded == job->meshes.size())
+            {
+                if(!job->failed)
+                {
+                    job->target->MakeResident();
+                    stats.modelsLoaded++;
+                }
+                vector<MeshData>().swap(job->meshes);
+                building.pop_front();
+                remaining--;
+                stats.decodedBytes = budget.Total();
+                stats.peakDecodedBytes = budget.Peak();
+            }
+            return true;
+        }
+
+        Event event;
+        {
+            lock_guard<mutex> lock(eventMutex);
+            if(events.empty())
+                return false;
+            event = std::move(events.front());
+            events.pop_front();
+        }
+        Job *job = event.job;
+        if(event.type == Event::IMPORTED)
+        {
+            job->imported = true;
+            job->texturesPending = event.textureCount;
+            job->target->directory = job->directory;
+            if(!job->failed)
+                job->target->SetPlaceholder(job->boundsMin, job->boundsMax);
+        }
+        else
+        {
+            TraceZone zone("upload texture", event.texturePath);
+            // upload (or find in the texture cache) and hand the texture to the model, AddMesh will find it there
+            TextureCache &cache = TextureCache::Instance();
+            Texture texture;
+            texture.type = event.textureType;
+            texture.path = event.texturePath;
+            texture.id = event.cached ? cache.AcquireByPath(event.cacheKey) : 0;
+            if(texture.id == 0)
+            {
+                if(event.cached)
+                {
+                    // released by its last owner since the worker looked, load it here after all. no pool: waiting
+                    // on it would run queued jobs on this thread, an import stalling the frame or a decode blocked
+                    // on budget only this thread releases
+                    TextureLoader::Load(event.cacheKey, false, event.texture, Model::TextureMipSettings(event.textureType));
+                    event.contentKey = TextureCache::ContentKey(event.texture, job->gamma);
+                }
+                if(!event.texture.Valid())
+                    std::cout << "Texture failed to load at path: " << event.texturePath << std::endl;
+                texture.id = cache.AcquireLoaded(event.cacheKey, event.texture, event.contentKey);
+                stats.texturesDecoded++;
+            }
+            job->target->AddLoadedTexture(texture);
+            job->texturesPending--;
+            event.texture = KtxTexture();
+            budget.Release(event.reservedBytes);
+        }
+        if(job->imported && job->texturesPending == 0)
+            building.push_back(job);
+        return true;
+    }
+
+    // worker: import the meshes, then fan out one decode job per distinct texture of the model
+    void importJob(Job *job)
+    {
+        if(cancelled)
+            return;
+        TraceZone zone("import", job->path);
+        job->failed = !Model::Import(job->path, job->meshes, nullptr, &pool);
+        if(cancelled)
+            return;
+
+        // bounds for the placeholder shown while the model streams in
+        bool first = true;
+        for(const MeshData &mesh : job->meshes)
+            for(const Vertex &vertex : mesh.vertices)
+            {
+                job->boundsMin = first ? vertex.Position : glm::min(job->boundsMin, vertex.Position);
+                job->boundsMax = first ? vertex.Position : glm::max(job->boundsMax, vertex.Position);
+                first = false;
+            }
+
+        // copied out, the main thread may build the model and drop its meshes as soon as the last decode lands
+        vector<Texture> unique;
+        set<string> seen;
+        for(const MeshData &mesh : job->meshes)
+            for(const Texture &texture : mesh.textures)
+                if(seen.insert(texture.path).second)
+                    unique.push_back(texture);
+
+        // the import event goes first so the main thread knows how many textures to wait for
+        Event imported;
+        imported.type = Event::IMPORTED;
+        imported.job = job;
+        imported.textureCount = (unsigned int)unique.size();
+        post(std::move(imported));
+
+        for(const Texture &texture : unique)
+        {
+            string type = texture.type;
+            string path = texture.path;
+            pool.Submit([this, job, type, path]() { decodeJob(job, type, path); });
+        }
+    }
+
+    // worker: reserve budget for the decoded size, then load the texture (building its mips and compressing it, on a
+    // cache miss) and hash it for the texture cache. textures some other model already has resident are neither
+    // loaded nor hashed.
+    void decodeJob(Job *job, string const &type, string const &path)
+    {
+        if(cancelled)
+            return;
+        TraceZone zone("load texture", path);
+        Event decoded;
+        decoded.type = Event::TEXTURE_DECODED;
+        decoded.job = job;
+        decoded.textureType = type;
+        decoded.texturePath = path;
+        decoded.cacheKey = TextureCache::NormalizePath(job->directory + '/' + path);
+        if(TextureCache::Instance().Contains(decoded.cacheKey))
+        {
+            decoded.cached = true;
+            post(std::move(decoded));
+            return;
+        }
+        decoded.reservedBytes = TextureLoader::PeekBytes(decoded.cacheKey);
+        if(!budget.Acquire(decoded.reservedBytes))
+            return;
+        // no pool here: textures already load in parallel, and helping with other queued jobs while holding budget
+        // could block this one behind a decode waiting for that very budget
+        TextureLoader::Load(decoded.cacheKey, false, decoded.texture, Model::TextureMipSettings(type));
+        decoded.contentKey = TextureCache::ContentKey(decoded.texture, job->gamma);
+        post(std::move(decoded));
+    }
+};
+#endif
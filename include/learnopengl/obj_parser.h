@@ -0,0 +1,660 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Wavefront OBJ/MTL reader producing the same MeshData the assimp import does, without going through assimp's
+// generic scene graph. the file is memory mapped and split at line boundaries into chunks that are parsed in
+// parallel over the pool (when one is given), the chunks are then stitched together and the meshes, one per
+// object/group and material as assimp splits them, are built in parallel as well.
+// matches the assimp post processing the models are imported with: polygons are fanned into triangles, uvs are
+// flipped, missing normals are smoothed over positions and tangents/bitangents are computed from the uvs.
+class ObjParser
+{
+public:
+    // stored as the import flags of the mesh cache, so meshes cached by the assimp path are never mixed up with
+    // these. bump it whenever the parser's output changes.
+    static const unsigned int CACHE_FLAGS = 0x4F424A01;
+    // chunks smaller than this aren't worth a thread
+    static const size_t MIN_CHUNK_BYTES = 64 * 1024;
+
+    static bool IsObj(const string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        if(dot == string::npos)
+            return false;
+        string extension = path.substr(dot + 1);
+        for(char &c : extension)
+            c = (char)tolower((unsigned char)c);
+        return extension == "obj";
+    }
+
+    static bool Parse(const string &path, vector<MeshData> &meshes, ThreadPool *pool = nullptr)
+    {
+        MappedFile file(path);
+        if(!file.IsOpen())
+        {
+            cout << "ERROR::OBJ_PARSER:: could not open " << path << endl;
+            return false;
+        }
+        const char *text = reinterpret_cast<const char*>(file.Data());
+        size_t size = file.Size();
+
+        // chunk boundaries just after a newline, so no line is split
+        size_t chunkCount = 1;
+        if(pool)
+            chunkCount = std::max<size_t>(1, std::min<size_t>(pool->Size() + 1, size / MIN_CHUNK_BYTES));
+        vector<size_t> bounds(chunkCount + 1, size);
+        bounds[0] = 0;
+        for(size_t i = 1; i < chunkCount; i++)
+        {
+            size_t at = std::max(bounds[i - 1], size / chunkCount * i);
+            const void *newline = at < size ? memchr(text + at, '\n', size - at) : nullptr;
+            bounds[i] = newline ? size_t(static_cast<const char*>(newline) - text) + 1 : size;
+        }
+
+        vector<Chunk> chunks(chunkCount);
+        forEach(pool, chunkCount, [&](size_t i) { parseChunk(text + bounds[i], text + bounds[i + 1], chunks[i]); });
+
+        Scene scene;
+        if(!stitch(chunks, pool, scene))
+        {
+            cout << "ERROR::OBJ_PARSER:: index out of range in " << path << endl;
+            return false;
+        }
+
+        string directory = path.substr(0, path.find_last_of('/'));
+        map<string, bool> libraries;
+        for(const Chunk &chunk : chunks)
+            for(const string &library : chunk.libraries)
+                if(!libraries[library])
+                {
+                    libraries[library] = true;
+                    if(!parseMaterials(directory + '/' + library, scene.materials))
+                        cout << "WARNING::OBJ_PARSER:: could not read material library " << library << endl;
+                }
+
+        meshes.clear();
+        meshes.resize(scene.groups.size());
+        forEach(pool, scene.groups.size(), [&](size_t i) { buildMesh(scene, chunks, scene.groups[i], meshes[i]); });
+        return true;
+    }
+
+    // parses a decimal float at p (optional sign, digits, fraction, exponent) and returns the position after it,
+    // or p itself when there is no number. exact for up to 15 significant digits and exponents within +-22, where
+    // mantissa and power of ten are both exact doubles; anything else goes through strtod.
+    static const char *ParseFloat(const char *p, const char *end, float &value)
+    {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        const char *start = p;
+        bool negative = false;
+        if(p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        bool any = false;
+        for(; p < end && unsigned(*p - '0') < 10; p++, any = true)
+        {
+            if(digits < 19)
+            {
+                mantissa = mantissa * 10 + unsigned(*p - '0');
+                digits += mantissa != 0;
+            }
+            else
+                exponent++;
+        }
+        if(p < end && *p == '.')
+            for(p++; p < end && unsigned(*p - '0') < 10; p++, any = true)
+                if(digits < 19)
+                {
+                    mantissa = mantissa * 10 + unsigned(*p - '0');
+                    digits += mantissa != 0;
+                    exponent--;
+                }
+        if(!any)
+            return parseFloatSlow(start, end, value);
+        if(p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char *q = p + 1;
+            bool negativeExponent = false;
+            if(q < end && (*q == '-' || *q == '+'))
+                negativeExponent = *q++ == '-';
+            if(q < end && unsigned(*q - '0') < 10)
+            {
+                int e = 0;
+                for(; q < end && unsigned(*q - '0') < 10; q++)
+                    e = std::min(e * 10 + (*q - '0'), 100000);
+                exponent += negativeExponent ? -e : e;
+                p = q;
+            }
+        }
+        if(digits > 15 || exponent < -22 || exponent > 22)
+            return parseFloatSlow(start, p, value);
+        double result = exponent < 0 ? double(mantissa) / powers[-exponent] : double(mantissa) * powers[exponent];
+        value = float(negative ? -result : result);
+        return p;
+    }
+
+    // texture path of a map_* statement, p pointing past the keyword. its options (-bm 1.0, -clamp on, -s 1 1 1, ...)
+    // are skipped, the path is the rest of the line and may hold spaces.
+    static string MapPath(const char *p, const char *end)
+    {
+        p = skipSpaces(p, end);
+        while(p < end && *p == '-')
+        {
+            // the option, then every argument that is a number or on/off
+            while(p < end && *p != ' ' && *p != '\t')
+                p++;
+            for(p = skipSpaces(p, end); p < end; p = skipSpaces(p, end))
+            {
+                const char *token = p;
+                while(p < end && *p != ' ' && *p != '\t')
+                    p++;
+                float number;
+                bool argument = ParseFloat(token, p, number) == p || keyword(token, p, "on") || keyword(token, p, "off");
+                if(!argument)
+                {
+                    p = token;
+                    break;
+                }
+            }
+        }
+        return restOfLine(p, end);
+    }
+
+private:
+    static const int NONE = INT_MIN;
+
+    // indices of a face corner, 0 based, NONE when left out. negative obj indices count back from the elements read
+    // so far; until the chunk's offset in the file is known they are stored relative to the chunk's start, with
+    // their bit (RELATIVE_POSITION, ...) set in relative.
+    enum { RELATIVE_POSITION = 1, RELATIVE_UV = 2, RELATIVE_NORMAL = 4 };
+    struct Corner {
+        int position, uv, normal;
+        int relative;
+        bool operator==(const Corner &other) const { return position == other.position && uv == other.uv && normal == other.normal; }
+    };
+
+    // a new object/group or material starting at firstCorner
+    struct Segment {
+        size_t firstCorner;
+        bool hasMaterial;
+        string material;
+    };
+
+    struct Chunk {
+        vector<glm::vec3> positions, normals;
+        vector<glm::vec2> uvs;
+        vector<Corner> corners;     // three per triangle
+        vector<Segment> segments;
+        vector<string> libraries;
+        vector<Corner> polygon;     // scratch
+        bool failed = false;
+    };
+
+    // corners [begin, end) of one chunk
+    struct Part {
+        size_t chunk, begin, end;
+    };
+
+    struct Group {
+        string material;
+        vector<Part> parts;
+    };
+
+    struct Scene {
+        vector<glm::vec3> positions, normals;
+        vector<glm::vec2> uvs;
+        vector<Group> groups;
+        map<string, vector<Texture>> materials;
+    };
+
+    template<typename F>
+    static void forEach(ThreadPool *pool, size_t count, F body)
+    {
+        if(pool && count > 1)
+            pool->ParallelFor(0, count, body);
+        else
+            for(size_t i = 0; i < count; i++)
+                body(i);
+    }
+
+    static const char *parseFloatSlow(const char *p, const char *end, float &value)
+    {
+        char buffer[64];
+        size_t length = std::min<size_t>(end - p, sizeof(buffer) - 1);
+        memcpy(buffer, p, length);
+        buffer[length] = '\0';
+        char *stop = buffer;
+        value = strtof(buffer, &stop);
+        return p + (stop - buffer);
+    }
+
+    static const char *parseInt(const char *p, const char *end, int &value, bool &ok)
+    {
+        bool negative = false;
+        if(p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        ok = p < end && unsigned(*p - '0') < 10;
+        long long result = 0;
+        for(; p < end && unsigned(*p - '0') < 10; p++)
+            result = std::min(result * 10 + (*p - '0'), (long long)INT_MAX);
+        value = int(negative ? -result : result);
+        return p;
+    }
+
+    static const char *skipSpaces(const char *p, const char *end)
+    {
+        while(p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        return p;
+    }
+
+    // rest of the line, without surrounding white space
+    static string restOfLine(const char *p, const char *end)
+    {
+        p = skipSpaces(p, end);
+        while(end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+            end--;
+        return string(p, end);
+    }
+
+    static bool keyword(const char *p, const char *end, const char *word)
+    {
+        size_t length = strlen(word);
+        return size_t(end - p) >= length && memcmp(p, word, length) == 0 &&
+               (size_t(end - p) == length || p[length] == ' ' || p[length] == '\t' || p[length] == '\r');
+    }
+
+    static void parseVector(const char *p, const char *end, float *values, int count)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            p = skipSpaces(p, end);
+            values[i] = 0.0f;
+            p = ParseFloat(p, end, values[i]);
+        }
+    }
+
+    // one obj index into the chunk's encoding, count being the number of elements the chunk has read so far
+    static int corner(int index, size_t count, int flag, Corner &c, bool &failed)
+    {
+        if(index > 0)
+            return index - 1;
+        if(index == 0)
+        {
+            failed = true;
+            return NONE;
+        }
+        c.relative |= flag;
+        return int((long long)count + index);
+    }
+
+    static void parseFace(const char *p, const char *end, Chunk &chunk)
+    {
+        vector<Corner> &polygon = chunk.polygon;
+        polygon.clear();
+        for(p = skipSpaces(p, end); p < end && *p != '\r'; p = skipSpaces(p, end))
+        {
+            Corner c = {NONE, NONE, NONE, 0};
+            int index;
+            bool ok;
+            p = parseInt(p, end, index, ok);
+            if(!ok)
+            {
+                chunk.failed = true;
+                return;
+            }
+            c.position = corner(index, chunk.positions.size(), RELATIVE_POSITION, c, chunk.failed);
+            if(p < end && *p == '/')
+            {
+                p = parseInt(p + 1, end, index, ok);
+                if(ok)
+                    c.uv = corner(index, chunk.uvs.size(), RELATIVE_UV, c, chunk.failed);
+                if(p < end && *p == '/')
+                {
+                    p = parseInt(p + 1, end, index, ok);
+                    if(ok)
+                        c.normal = corner(index, chunk.normals.size(), RELATIVE_NORMAL, c, chunk.failed);
+                }
+            }
+            polygon.push_back(c);
+            while(p < end && *p != ' ' && *p != '\t' && *p != '\r')
+                p++;
+        }
+        // fan, as aiProcess_Triangulate does for convex polygons
+        for(size_t i = 2; i < polygon.size(); i++)
+        {
+            chunk.corners.push_back(polygon[0]);
+            chunk.corners.push_back(polygon[i - 1]);
+            chunk.corners.push_back(polygon[i]);
+        }
+    }
+
+    static void parseLine(const char *p, const char *end, Chunk &chunk)
+    {
+        p = skipSpaces(p, end);
+        if(p >= end)
+            return;
+        float values[3];
+        switch(*p)
+        {
+            case 'v':
+                if(keyword(p, end, "v"))
+                {
+                    parseVector(p + 1, end, values, 3);
+                    chunk.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+                }
+                else if(keyword(p, end, "vt"))
+                {
+                    parseVector(p + 2, end, values, 2);
+                    chunk.uvs.push_back(glm::vec2(values[0], values[1]));
+                }
+                else if(keyword(p, end, "vn"))
+                {
+                    parseVector(p + 2, end, values, 3);
+                    chunk.normals.push_back(glm::vec3(values[0], values[1], values[2]));
+                }
+                break;
+            case 'f':
+                if(keyword(p, end, "f"))
+                    parseFace(p + 1, end, chunk);
+                break;
+            case 'o':
+            case 'g':
+                if(keyword(p, end, "o") || keyword(p, end, "g"))
+                    chunk.segments.push_back(Segment{chunk.corners.size(), false, string()});
+                break;
+            case 'u':
+                if(keyword(p, end, "usemtl"))
+                    chunk.segments.push_back(Segment{chunk.corners.size(), true, restOfLine(p + 6, end)});
+                break;
+            case 'm':
+                if(keyword(p, end, "mtllib"))
+                    chunk.libraries.push_back(restOfLine(p + 6, end));
+                break;
+            default:
+                break;
+        }
+    }
+
+    static void parseChunk(const char *p, const char *end, Chunk &chunk)
+    {
+        // rough guesses from the chunk size, saving most of the regrowth
+        size_t bytes = size_t(end - p);
+        chunk.positions.reserve(bytes / 128);
+        chunk.corners.reserve(bytes / 16);
+        while(p < end)
+        {
+            const char *lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if(!lineEnd)
+                lineEnd = end;
+            parseLine(p, lineEnd, chunk);
+            p = lineEnd + 1;
+        }
+    }
+
+    // concatenates the vertex data of the chunks, resolves relative indices and splits the faces into groups
+    static bool stitch(vector<Chunk> &chunks, ThreadPool *pool, Scene &scene)
+    {
+        vector<size_t> positionBase(chunks.size()), uvBase(chunks.size()), normalBase(chunks.size());
+        size_t positions = 0, uvs = 0, normals = 0;
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            if(chunks[i].failed)
+                return false;
+            positionBase[i] = positions;
+            uvBase[i] = uvs;
+            normalBase[i] = normals;
+            positions += chunks[i].positions.size();
+            uvs += chunks[i].uvs.size();
+            normals += chunks[i].normals.size();
+        }
+        scene.positions.resize(positions);
+        scene.uvs.resize(uvs);
+        scene.normals.resize(normals);
+
+        forEach(pool, chunks.size(), [&](size_t i) {
+            Chunk &chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), scene.positions.begin() + positionBase[i]);
+            std::copy(chunk.uvs.begin(), chunk.uvs.end(), scene.uvs.begin() + uvBase[i]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), scene.normals.begin() + normalBase[i]);
+            vector<glm::vec3>().swap(chunk.positions);
+            vector<glm::vec2>().swap(chunk.uvs);
+            vector<glm::vec3>().swap(chunk.normals);
+            auto resolve = [&chunk](int &index, bool relative, size_t base, size_t count) {
+                if(index == NONE)
+                    return;
+                long long absolute = relative ? (long long)base + index : index;
+                if(absolute < 0 || absolute >= (long long)count)
+                    chunk.failed = true;
+                index = int(absolute);
+            };
+            for(Corner &c : chunk.corners)
+            {
+                resolve(c.position, c.relative & RELATIVE_POSITION, positionBase[i], positions);
+                resolve(c.uv, c.relative & RELATIVE_UV, uvBase[i], uvs);
+                resolve(c.normal, c.relative & RELATIVE_NORMAL, normalBase[i], normals);
+                c.relative = 0;
+            }
+        });
+        for(const Chunk &chunk : chunks)
+            if(chunk.failed)
+                return false;
+
+        // a new mesh starts at every object, group and material. groups are only opened by faces, so objects
+        // without any faces leave nothing behind.
+        string material;
+        bool startNew = true;
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            size_t cursor = 0;
+            auto take = [&](size_t upTo) {
+                if(upTo > cursor)
+                {
+                    if(startNew)
+                        scene.groups.push_back(Group{material, vector<Part>()});
+                    startNew = false;
+                    scene.groups.back().parts.push_back(Part{i, cursor, upTo});
+                }
+                cursor = upTo;
+            };
+            for(const Segment &segment : chunks[i].segments)
+            {
+                take(segment.firstCorner);
+                if(segment.hasMaterial)
+                    material = segment.material;
+                startNew = true;
+            }
+            take(chunks[i].corners.size());
+        }
+        return true;
+    }
+
+    // the maps assimp would report as diffuse, specular, height and ambient, in the order processMesh collects them
+    static bool parseMaterials(const string &path, map<string, vector<Texture>> &materials)
+    {
+        MappedFile file(path);
+        if(!file.IsOpen())
+            return false;
+        const char *p = reinterpret_cast<const char*>(file.Data());
+        const char *end = p + file.Size();
+        string name;
+        map<string, array<vector<Texture>, 4>> maps;
+        static const char *types[4] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+        while(p < end)
+        {
+            const char *lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+            if(!lineEnd)
+                lineEnd = end;
+            p = skipSpaces(p, lineEnd);
+            int slot = -1;
+            const char *rest = p;
+            if(keyword(p, lineEnd, "newmtl"))
+            {
+                name = restOfLine(p + 6, lineEnd);
+                maps[name];
+            }
+            else if(keyword(p, lineEnd, "map_Kd"))
+                slot = 0, rest = p + 6;
+            else if(keyword(p, lineEnd, "map_Ks"))
+                slot = 1, rest = p + 6;
+            else if(keyword(p, lineEnd, "map_Bump") || keyword(p, lineEnd, "map_bump"))
+                slot = 2, rest = p + 8;
+            else if(keyword(p, lineEnd, "bump"))
+                slot = 2, rest = p + 4;
+            else if(keyword(p, lineEnd, "map_Ka"))
+                slot = 3, rest = p + 6;
+            if(slot >= 0)
+            {
+                Texture texture;
+                texture.id = 0;
+                texture.type = types[slot];
+                texture.path = MapPath(rest, lineEnd);
+                if(!texture.path.empty())
+                    maps[name][slot].push_back(texture);
+            }
+            p = lineEnd + 1;
+        }
+        for(auto &entry : maps)
+        {
+            vector<Texture> &textures = materials[entry.first];
+            textures.clear();
+            for(int slot = 0; slot < 4; slot++)
+                textures.insert(textures.end(), entry.second[slot].begin(), entry.second[slot].end());
+        }
+        return true;
+    }
+
+    static void buildMesh(const Scene &scene, const vector<Chunk> &chunks, const Group &group, MeshData &mesh)
+    {
+        auto material = scene.materials.find(group.material);
+        if(material != scene.materials.end())
+            mesh.textures = material->second;
+
+        // meshes cover a contiguous run of positions in practice, the vertices made from each position are chained
+        // through next so a corner only gets compared with the few vertices sharing its position
+        size_t cornerCount = 0;
+        int low = INT_MAX, high = -1;
+        for(const Part &part : group.parts)
+        {
+            cornerCount += part.end - part.begin;
+            for(size_t i = part.begin; i < part.end; i++)
+            {
+                low = std::min(low, chunks[part.chunk].corners[i].position);
+                high = std::max(high, chunks[part.chunk].corners[i].position);
+            }
+        }
+        if(high < low)
+            return;
+        mesh.indices.reserve(cornerCount);
+        vector<unsigned int> first(size_t(high - low) + 1, ~0u);
+        vector<unsigned int> next;
+        vector<Corner> cornerOf;
+        bool missingNormals = false, hasUvs = false;
+        for(const Part &part : group.parts)
+            for(size_t i = part.begin; i < part.end; i++)
+            {
+                const Corner &c = chunks[part.chunk].corners[i];
+                unsigned int &head = first[c.position - low];
+                unsigned int index = head;
+                while(index != ~0u && !(cornerOf[index] == c))
+                    index = next[index];
+                if(index == ~0u)
+                {
+                    index = (unsigned int)mesh.vertices.size();
+                    Vertex vertex;
+                    vertex.Position = scene.positions[c.position];
+                    vertex.Normal = c.normal != NONE ? scene.normals[c.normal] : glm::vec3(0.0f);
+                    // aiProcess_FlipUVs
+                    vertex.TexCoords = c.uv != NONE ? glm::vec2(scene.uvs[c.uv].x, 1.0f - scene.uvs[c.uv].y) : glm::vec2(0.0f);
+                    vertex.Tangent = glm::vec3(0.0f);
+                    vertex.Bitangent = glm::vec3(0.0f);
+                    mesh.vertices.push_back(vertex);
+                    cornerOf.push_back(c);
+                    next.push_back(head);
+                    head = index;
+                    missingNormals = missingNormals || c.normal == NONE;
+                    hasUvs = hasUvs || c.uv != NONE;
+                }
+                mesh.indices.push_back(index);
+            }
+
+        if(missingNormals)
+            smoothNormals(mesh, cornerOf);
+        if(hasUvs)
+            tangents(mesh);
+    }
+
+    // aiProcess_GenSmoothNormals for the vertices the file gave no normal: area weighted face normals summed over
+    // every vertex at the same position
+    static void smoothNormals(MeshData &mesh, const vector<Corner> &cornerOf)
+    {
+        unordered_map<int, glm::vec3> sums;
+        for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const glm::vec3 &a = mesh.vertices[mesh.indices[i]].Position;
+            const glm::vec3 &b = mesh.vertices[mesh.indices[i + 1]].Position;
+            const glm::vec3 &c = mesh.vertices[mesh.indices[i + 2]].Position;
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            for(int k = 0; k < 3; k++)
+                sums[cornerOf[mesh.indices[i + k]].position] += normal;
+        }
+        for(size_t v = 0; v < mesh.vertices.size(); v++)
+            if(cornerOf[v].normal == NONE)
+                mesh.vertices[v].Normal = VertexPacking::SafeNormalize(sums[cornerOf[v].position]);
+    }
+
+    // aiProcess_CalcTangentSpace: per triangle uv derivatives summed over each vertex, then made orthogonal to the
+    // normal
+    static void tangents(MeshData &mesh)
+    {
+        vector<Vertex> &vertices = mesh.vertices;
+        for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            Vertex &a = vertices[mesh.indices[i]], &b = vertices[mesh.indices[i + 1]], &c = vertices[mesh.indices[i + 2]];
+            glm::vec3 e1 = b.Position - a.Position, e2 = c.Position - a.Position;
+            glm::vec2 d1 = b.TexCoords - a.TexCoords, d2 = c.TexCoords - a.TexCoords;
+            float determinant = d1.x * d2.y - d2.x * d1.y;
+            if(std::fabs(determinant) < 1e-12f)
+                continue;
+            float r = 1.0f / determinant;
+            glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+            glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+            for(Vertex *vertex : {&a, &b, &c})
+            {
+                vertex->Tangent += tangent;
+                vertex->Bitangent += bitangent;
+            }
+        }
+        for(Vertex &vertex : vertices)
+        {
+            const glm::vec3 &n = vertex.Normal;
+            vertex.Tangent = VertexPacking::SafeNormalize(vertex.Tangent - n * glm::dot(n, vertex.Tangent));
+            vertex.Bitangent = VertexPacking::SafeNormalize(vertex.Bitangent - n * glm::dot(n, vertex.Bitangent));
+        }
+    }
+};
+
+#endif
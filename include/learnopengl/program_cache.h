@@ -0,0 +1,248 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/content_hash.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// ARB_get_program_binary (core in 4.1), not part of the 3.3 loader
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// on-disk cache of linked shader programs. the driver's binary is stored next to the vertex shader
+// (<shader>.progbin) together with a key made of the shader sources and the GL vendor, renderer and version
+// strings, so an edited shader or an updated driver is simply a miss. the driver may still refuse a binary that
+// matches (it is free to invalidate them at any time); Load then reports a miss and the caller compiles from
+// source as usual.
+//
+// Init has to run on the context thread after the gl loader, programs built before it are never cached.
+// RG_SHADER_CACHE=off disables the cache.
+class ProgramCache
+{
+public:
+    // bump whenever the file layout changes
+    static const uint32_t VERSION = 1;
+
+    struct Stats {
+        unsigned int hits = 0;
+        unsigned int misses = 0;
+        unsigned int rejected = 0;      // binaries the driver would not load, a subset of misses
+        unsigned int stored = 0;
+    };
+
+    // loads the program binary entry points and checks that the driver offers at least one binary format
+    static void Init(GLADloadproc loader)
+    {
+        Functions &gl = functions();
+        gl = Functions();
+        const char *env = getenv("RG_SHADER_CACHE");
+        if(env && strcmp(env, "off") == 0)
+            return;
+
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool supported = major > 4 || (major == 4 && minor >= 1);
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for(GLint i = 0; i < count && !supported; i++)
+        {
+            const char *name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if(name && strcmp(name, "GL_ARB_get_program_binary") == 0)
+                supported = true;
+        }
+        if(!supported)
+            return;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if(formats <= 0)
+            return;
+
+        gl.getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(loader("glGetProgramBinary"));
+        gl.programBinary = reinterpret_cast<ProgramBinaryProc>(loader("glProgramBinary"));
+        gl.programParameteri = reinterpret_cast<ProgramParameteriProc>(loader("glProgramParameteri"));
+        if(!gl.getProgramBinary || !gl.programBinary || !gl.programParameteri)
+        {
+            gl = Functions();
+            return;
+        }
+        driverKey() = ContentHash::String(glString(GL_VENDOR), ContentHash::String(glString(GL_RENDERER), ContentHash::String(glString(GL_VERSION))));
+    }
+
+    static bool IsAvailable()
+    {
+        return functions().programBinary != nullptr;
+    }
+
+    // variants of one program (see ShaderVariants) are told apart by their defines
+    static string PathFor(const string &vertexPath, const string &defines = string())
+    {
+        if(defines.empty())
+            return vertexPath + ".progbin";
+        return vertexPath + "." + ContentHash::ToHex(ContentHash::String(defines)) + ".progbin";
+    }
+
+    // key of a program built from the given sources (empty for missing stages) with the current driver
+    static uint64_t Key(const string &vertexCode, const string &fragmentCode, const string &geometryCode)
+    {
+        uint64_t key = ContentHash::Combine(driverKey(), ContentHash::String(vertexCode));
+        key = ContentHash::Combine(key, ContentHash::String(fragmentCode));
+        return ContentHash::Combine(key, ContentHash::String(geometryCode));
+    }
+
+    // loads the cached binary into the program (created, nothing attached). false if there is no usable entry or
+    // the driver rejected it, the program can then be built from source.
+    static bool Load(const string &cachePath, uint64_t key, GLuint program)
+    {
+        if(!IsAvailable())
+            return false;
+        Header header;
+        vector<char> binary;
+        ifstream in(cachePath, ios::binary);
+        if(!in || !in.read(reinterpret_cast<char*>(&header), sizeof(Header)) || memcmp(header.magic, MAGIC, 4) != 0 ||
+           header.version != VERSION || header.key != key || header.length == 0)
+        {
+            stats().misses++;
+            return false;
+        }
+        binary.resize(header.length);
+        if(!in.read(binary.data(), binary.size()))
+        {
+            stats().misses++;
+            return false;
+        }
+
+        functions().programBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if(!linked)
+        {
+            stats().misses++;
+            stats().rejected++;
+            return false;
+        }
+        stats().hits++;
+        return true;
+    }
+
+    // has to be called before the program is linked, drivers may otherwise keep no retrievable binary
+    static void PrepareForStore(GLuint program)
+    {
+        if(IsAvailable())
+            functions().programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // writes the binary of a linked program. written under a temporary name and renamed into place, like the
+    // other caches.
+    static bool Store(const string &cachePath, uint64_t key, GLuint program)
+    {
+        if(!IsAvailable())
+            return false;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if(length <= 0)
+            return false;
+        vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        functions().getProgramBinary(program, length, &written, &format, binary.data());
+        if(written <= 0)
+            return false;
+
+        Header header;
+        memcpy(header.magic, MAGIC, 4);
+        header.version = VERSION;
+        header.format = format;
+        header.length = (uint32_t)written;
+        header.key = key;
+        string tmpPath = cachePath + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            if(!out)
+                return false;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            out.write(binary.data(), written);
+            if(!out)
+            {
+                out.close();
+                std::remove(tmpPath.c_str());
+                return false;
+            }
+        }
+        if(std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        stats().stored++;
+        return true;
+    }
+
+    static Stats GetStats()
+    {
+        return stats();
+    }
+
+private:
+    static constexpr const char *MAGIC = "RGPB";
+
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    struct Functions {
+        GetProgramBinaryProc getProgramBinary = nullptr;
+        ProgramBinaryProc programBinary = nullptr;
+        ProgramParameteriProc programParameteri = nullptr;
+    };
+
+    struct Header {
+        char     magic[4];
+        uint32_t version;
+        uint32_t format;
+        uint32_t length;
+        uint64_t key;
+    };
+
+    static Functions &functions()
+    {
+        static Functions gl;
+        return gl;
+    }
+
+    static uint64_t &driverKey()
+    {
+        static uint64_t key = 0;
+        return key;
+    }
+
+    static Stats &stats()
+    {
+        static Stats s;
+        return s;
+    }
+
+    static string glString(GLenum name)
+    {
+        const char *value = reinterpret_cast<const char*>(glGetString(name));
+        return value ? string(value) : string();
+    }
+};
+#endif
@@ -0,0 +1,286 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+using namespace std;
+
+// the passes a frame is drawn in, each with a queue of its own. opaque items are drawn front to back after being
+// grouped by program and material, transparent ones (meshes whose Material is blended) back to front after them; the
+// shadow pass binds no materials, the depth programs sample no textures. the ui pass only holds callbacks, drawn in
+// the order they were added.
+enum RenderPass {
+    RENDER_PASS_SHADOW,
+    RENDER_PASS_OPAQUE,
+    RENDER_PASS_TRANSPARENT,
+    RENDER_PASS_UI,
+    RENDER_PASS_COUNT
+};
+
+// one draw: a mesh at a level of detail, a plain glDrawArrays over a VAO, or a callback drawing something the queue
+// knows nothing about (the skybox, the gui). a callback may change any state, everything is bound again after it.
+struct RenderItem {
+    uint64_t key = 0;
+    Shader *shader = nullptr;
+    const Material *material = nullptr;     // nullptr for items that bind none
+    const string *materialPrefix = nullptr; // uniform prefix of the material in shader
+    Mesh *mesh = nullptr;
+    size_t lod = 0;
+    unsigned int vao = 0;
+    unsigned int arrayCount = 0;            // vertices of a glDrawArrays item, when there is no mesh
+    glm::mat4 transform = glm::mat4(1.0f);  // the shader's "model"
+    float shininess = 32.0f;
+    void (*callback)(void *context) = nullptr;
+    void *context = nullptr;
+};
+
+// collects the draws of a frame, sorts every pass by its 64 bit keys and submits them with as few program, material
+// and VAO changes as the order allows; the VAO binds go through GLState, which drops the repeated ones. the item
+// lists keep their capacity, a frame allocates nothing once the queue has grown to the scene.
+//
+// key layout, high to low: layer (2 bits, items of a higher layer go after the lower ones whatever the rest says),
+// then for opaque and shadow items program (12), material (16) and depth (24); transparent items have the reversed
+// depth first and program and material after it.
+class RenderQueue
+{
+public:
+    // counted over every Submit since the last ResetStats
+    struct Stats {
+        size_t items = 0;
+        size_t programSwitches = 0;
+        size_t materialBinds = 0;
+        size_t materialBindsAvoided = 0;    // items drawn with the material of the item before them
+        size_t textureBindsAvoided = 0;     // texture binds those skipped
+    };
+
+    // with false the material is left out of the keys, items of one program are then only ordered by depth
+    bool sortByMaterial = true;
+
+    RenderQueue() = default;
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // empties every pass and sets the point depths are measured from, farPlane being the distance that maps to the
+    // largest depth key
+    void Begin(const glm::vec3 &viewPosition, float farPlane)
+    {
+        for(vector<RenderItem> &pass : items)
+            pass.clear();
+        view = viewPosition;
+        depthScale = farPlane > 0.0f ? 1.0f / farPlane : 0.0f;
+    }
+
+    // a mesh of a model whose shared buffers are geometry, placed by transform
+    void AddMesh(RenderPass pass, Shader &shader, Mesh &mesh, size_t lod, const GeometryArena &geometry,
+                 const glm::mat4 &transform, float shininess)
+    {
+        RenderItem item;
+        item.shader = &shader;
+        item.mesh = &mesh;
+        item.lod = lod;
+        item.vao = geometry.VertexArray();
+        item.transform = transform;
+        item.shininess = shininess;
+        if(pass != RENDER_PASS_SHADOW)
+        {
+            item.material = &mesh.material;
+            item.materialPrefix = &mesh.glslIdentifierPrefix;
+        }
+        glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.boundsCenter, 1.0f));
+        add(pass, item, glm::length(center - view));
+    }
+
+    // glDrawArrays(GL_TRIANGLES, 0, count) over vao, with an optional material
+    void AddArrays(RenderPass pass, Shader &shader, unsigned int vao, unsigned int count, const glm::mat4 &transform,
+                   const Material *material = nullptr, const string *materialPrefix = nullptr, float shininess = 32.0f)
+    {
+        RenderItem item;
+        item.shader = &shader;
+        item.vao = vao;
+        item.arrayCount = count;
+        item.transform = transform;
+        item.shininess = shininess;
+        item.material = pass != RENDER_PASS_SHADOW ? material : nullptr;
+        item.materialPrefix = materialPrefix;
+        add(pass, item, glm::length(glm::vec3(transform[3]) - view));
+    }
+
+    // callback(context) at its place in the pass: layer orders it against the other items, within its layer it comes
+    // first. ui callbacks keep the order they were added in.
+    void AddCallback(RenderPass pass, unsigned int layer, void (*callback)(void*), void *context)
+    {
+        RenderItem item;
+        item.callback = callback;
+        item.context = context;
+        item.key = (uint64_t)(layer & 3) << 62;
+        if(pass == RENDER_PASS_UI)
+            item.key |= items[pass].size();
+        items[pass].push_back(item);
+    }
+
+    // puts the items of every pass in key order
+    void Sort()
+    {
+        for(int pass = 0; pass < RENDER_PASS_COUNT; pass++)
+            radixSort(items[pass], order[pass]);
+    }
+
+    // draws a sorted pass. onProgram is called whenever a program is made current, for the uniforms the items don't
+    // set themselves (everything but "model", "material.shininess" and the GeometryUniforms, whose handles are
+    // resolved once per program switch). the state of the last item is left bound.
+    void Submit(RenderPass pass, const function<void(Shader&)> &onProgram = function<void(Shader&)>())
+    {
+        static const string modelName = "model";
+        static const string shininessName = "material.shininess";
+        Stats &frame = stats();
+        Shader *program = nullptr;
+        const RenderItem *bound = nullptr;      // item whose material is bound
+        UniformHandle<glm::mat4> model;
+        UniformHandle<float> shininess;
+        GeometryUniforms geometry;
+        for(unsigned int index : order[pass])
+        {
+            const RenderItem &item = items[pass][index];
+            frame.items++;
+            if(item.callback)
+            {
+                item.callback(item.context);
+                program = nullptr;
+                bound = nullptr;
+                continue;
+            }
+            if(item.shader != program)
+            {
+                program = item.shader;
+                program->use();
+                if(onProgram)
+                    onProgram(*program);
+                model = program->uniform<glm::mat4>(modelName);
+                shininess = program->uniform<float>(shininessName);
+                geometry = GeometryUniforms(*program);
+                bound = nullptr;
+                frame.programSwitches++;
+            }
+            if(item.material)
+            {
+                if(bound && *bound->material == *item.material && *bound->materialPrefix == *item.materialPrefix)
+                {
+                    frame.materialBindsAvoided++;
+                    frame.textureBindsAvoided += item.material->TextureCount();
+                }
+                else
+                {
+                    item.material->Bind(*program, *item.materialPrefix);
+                    bound = &item;
+                    frame.materialBinds++;
+                }
+            }
+            GLState::BindVertexArray(item.vao);
+            program->set(model, item.transform);
+            program->set(shininess, item.shininess);
+            if(item.mesh)
+                item.mesh->DrawGeometry(*program, geometry, item.lod);
+            else
+            {
+                // plain float positions
+                program->set(geometry.quantizedPosition, false);
+                glDrawArrays(GL_TRIANGLES, 0, item.arrayCount);
+            }
+        }
+    }
+
+    size_t Size(RenderPass pass) const { return items[pass].size(); }
+
+    static const Stats &GetStats() { return stats(); }
+    static void ResetStats() { stats() = Stats(); }
+
+private:
+    vector<RenderItem> items[RENDER_PASS_COUNT];
+    // item indices in key order, and the scratch space of the sort
+    vector<unsigned int> order[RENDER_PASS_COUNT];
+    vector<uint64_t> keys, keysScratch;
+    vector<unsigned int> orderScratch;
+    glm::vec3 view = glm::vec3(0.0f);
+    float depthScale = 0.0f;
+
+    static Stats &stats()
+    {
+        static Stats frame;
+        return frame;
+    }
+
+    void add(RenderPass pass, RenderItem &item, float distance)
+    {
+        const uint64_t depthMax = (1u << 24) - 1;
+        uint64_t depth = (uint64_t)(std::min(std::max(distance * depthScale, 0.0f), 1.0f) * depthMax);
+        uint64_t program = item.shader->ID & 0xFFF;
+        uint64_t material = sortByMaterial && item.material ? materialBits(*item.material) : 0;
+        if(pass == RENDER_PASS_TRANSPARENT)
+            item.key = (depthMax - depth) << 38 | program << 26 | material << 10;
+        else
+            item.key = program << 50 | material << 34 | depth << 10;
+        items[pass].push_back(item);
+    }
+
+    // 16 bits telling materials apart. equal materials always get the same bits, so they end up next to each other;
+    // a collision only costs a bind, Submit compares the materials themselves.
+    static uint64_t materialBits(const Material &material)
+    {
+        uint32_t h = 2166136261u;
+        for(unsigned int texture : material.textures)
+            h = (h ^ texture) * 16777619u;
+        h = (h ^ material.colorSlots) * 16777619u;
+        return (h ^ (h >> 16)) & 0xFFFF;
+    }
+
+    // least significant digit first radix sort of the keys, a byte per round. rounds where every key has the same
+    // byte are skipped, with the keys above mostly zero that leaves a few rounds.
+    void radixSort(const vector<RenderItem> &pass, vector<unsigned int> &sorted)
+    {
+        size_t n = pass.size();
+        sorted.resize(n);
+        keys.resize(n);
+        keysScratch.resize(n);
+        orderScratch.resize(n);
+        for(size_t i = 0; i < n; i++)
+        {
+            sorted[i] = (unsigned int)i;
+            keys[i] = pass[i].key;
+        }
+        for(int shift = 0; shift < 64; shift += 8)
+        {
+            size_t counts[256] = {};
+            for(size_t i = 0; i < n; i++)
+                counts[(keys[i] >> shift) & 0xFF]++;
+            if(n == 0 || counts[(keys[0] >> shift) & 0xFF] == n)
+                continue;
+            size_t offset = 0;
+            for(size_t &count : counts)
+            {
+                size_t c = count;
+                count = offset;
+                offset += c;
+            }
+            for(size_t i = 0; i < n; i++)
+            {
+                size_t to = counts[(keys[i] >> shift) & 0xFF]++;
+                keysScratch[to] = keys[i];
+                orderScratch[to] = sorted[i];
+            }
+            keys.swap(keysScratch);
+            sorted.swap(orderScratch);
+        }
+    }
+};
+#endif
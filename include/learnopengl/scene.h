@@ -0,0 +1,314 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/vertex_format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// a model file the scene draws, loaded once however many instances use it
+struct SceneAsset {
+    string name;
+    string path;
+    VertexFormat format = VERTEX_FLOAT;
+};
+
+struct SceneMaterial {
+    string name;
+    float shininess = 32.0f;
+};
+
+// one placed copy of an asset. kept small and free of strings, the passes walk the whole table every frame.
+struct SceneInstance {
+    glm::mat4 transform;
+    unsigned int asset;         // index into Scene::assets
+    unsigned int material;      // index into Scene::materials
+};
+
+struct ScenePointLight {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 ambient = glm::vec3(0.0f);
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    glm::vec3 specular = glm::vec3(0.0f);
+    float constant = 1.0f, linear = 0.0f, quadratic = 0.0f;
+};
+
+struct SceneDirectionLight {
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    glm::vec3 ambient = glm::vec3(0.0f);
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    glm::vec3 specular = glm::vec3(0.0f);
+};
+
+// attached to the camera, only its look is part of the scene
+struct SceneSpotLight {
+    glm::vec3 ambient = glm::vec3(0.0f);
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    glm::vec3 specular = glm::vec3(0.0f);
+    float cutOff = 12.5f, outerCutOff = 17.5f;     // degrees
+    float constant = 1.0f, linear = 0.0f, quadratic = 0.0f;
+};
+
+// the assets, instances, materials and lights of a scene, read from a line based text file (see
+// resources/scenes/parking.scene for the format). instances end up in one flat table sorted by asset and then
+// material, so a pass walking it draws all copies of a model, and of a material, back to back.
+class Scene
+{
+public:
+    vector<SceneAsset> assets;
+    vector<SceneMaterial> materials;
+    vector<SceneInstance> instances;
+    // names of the instances, same order as the table
+    vector<string> instanceNames;
+    vector<ScenePointLight> pointLights;
+    SceneDirectionLight directionLight;
+    SceneSpotLight spotLight;
+
+    // replaces the scene with the file's content. on any error the scene is left empty and the offending line is
+    // reported; more point lights than maxPointLights (what the lighting shaders have room for) are an error too.
+    bool Load(const string &path, size_t maxPointLights = SIZE_MAX)
+    {
+        *this = Scene();
+        this->maxPointLights = maxPointLights;
+        ifstream in(path);
+        if(!in)
+        {
+            cout << "ERROR::SCENE:: could not open " << path << endl;
+            return false;
+        }
+        vector<string> pendingNames;
+        vector<SceneInstance> pending;
+        string line;
+        for(int number = 1; getline(in, line); number++)
+        {
+            vector<string> tokens = split(line);
+            if(tokens.empty())
+                continue;
+            string error = parseLine(tokens, pending, pendingNames);
+            if(!error.empty())
+            {
+                cout << "ERROR::SCENE:: " << path << ":" << number << ": " << error << endl;
+                *this = Scene();
+                return false;
+            }
+        }
+
+        vector<size_t> order(pending.size());
+        for(size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&pending](size_t a, size_t b) {
+            return pending[a].asset != pending[b].asset ? pending[a].asset < pending[b].asset : pending[a].material < pending[b].material;
+        });
+        instances.reserve(pending.size());
+        instanceNames.reserve(pending.size());
+        for(size_t i : order)
+        {
+            instances.push_back(pending[i]);
+            instanceNames.push_back(pendingNames[i]);
+        }
+        return true;
+    }
+
+    // index of the named instance in the table, -1 if there is none
+    int FindInstance(const string &name) const
+    {
+        for(size_t i = 0; i < instanceNames.size(); i++)
+            if(instanceNames[i] == name)
+                return (int)i;
+        return -1;
+    }
+
+private:
+    size_t maxPointLights = SIZE_MAX;
+
+    static vector<string> split(const string &line)
+    {
+        vector<string> tokens;
+        istringstream stream(line.substr(0, line.find('#')));
+        string token;
+        while(stream >> token)
+            tokens.push_back(token);
+        return tokens;
+    }
+
+    static bool readNumber(const vector<string> &tokens, size_t i, float &value)
+    {
+        if(i >= tokens.size())
+            return false;
+        char *end = nullptr;
+        value = strtof(tokens[i].c_str(), &end);
+        return end != tokens[i].c_str() && *end == '\0';
+    }
+
+    static bool readVec3(const vector<string> &tokens, size_t i, glm::vec3 &value)
+    {
+        return readNumber(tokens, i, value.x) && readNumber(tokens, i + 1, value.y) && readNumber(tokens, i + 2, value.z);
+    }
+
+    template<typename T>
+    static int find(const vector<T> &items, const string &name)
+    {
+        for(size_t i = 0; i < items.size(); i++)
+            if(items[i].name == name)
+                return (int)i;
+        return -1;
+    }
+
+    string parseLine(const vector<string> &tokens, vector<SceneInstance> &pending, vector<string> &pendingNames)
+    {
+        const string &kind = tokens[0];
+        if(kind == "asset")
+        {
+            if(tokens.size() < 3 || tokens.size() > 4)
+                return "expected asset <name> <path> [float|compact|quantized]";
+            if(find(assets, tokens[1]) >= 0)
+                return "asset " + tokens[1] + " defined twice";
+            SceneAsset asset;
+            asset.name = tokens[1];
+            asset.path = tokens[2];
+            if(tokens.size() == 4)
+            {
+                if(tokens[3] == "float")
+                    asset.format = VERTEX_FLOAT;
+                else if(tokens[3] == "compact")
+                    asset.format = VERTEX_COMPACT;
+                else if(tokens[3] == "quantized")
+                    asset.format = VERTEX_COMPACT_QUANTIZED;
+                else
+                    return "unknown vertex format " + tokens[3];
+            }
+            assets.push_back(asset);
+            return string();
+        }
+        if(kind == "material")
+        {
+            SceneMaterial material;
+            if(tokens.size() != 4 || tokens[2] != "shininess" || !readNumber(tokens, 3, material.shininess))
+                return "expected material <name> shininess <value>";
+            if(find(materials, tokens[1]) >= 0)
+                return "material " + tokens[1] + " defined twice";
+            material.name = tokens[1];
+            materials.push_back(material);
+            return string();
+        }
+        if(kind == "instance")
+        {
+            if(tokens.size() < 4)
+                return "expected instance <name> <asset> <material> <transform...>";
+            int asset = find(assets, tokens[2]), material = find(materials, tokens[3]);
+            if(asset < 0)
+                return "unknown asset " + tokens[2];
+            if(material < 0)
+                return "unknown material " + tokens[3];
+            SceneInstance instance;
+            instance.asset = (unsigned int)asset;
+            instance.material = (unsigned int)material;
+            string error = parseTransform(tokens, 4, instance.transform);
+            if(!error.empty())
+                return error;
+            pending.push_back(instance);
+            pendingNames.push_back(tokens[1]);
+            return string();
+        }
+        if(kind == "light" && tokens.size() >= 2)
+            return parseLight(tokens);
+        return "unknown statement " + kind;
+    }
+
+    static string parseTransform(const vector<string> &tokens, size_t i, glm::mat4 &transform)
+    {
+        transform = glm::mat4(1.0f);
+        while(i < tokens.size())
+        {
+            const string &op = tokens[i];
+            glm::vec3 v;
+            float angle;
+            if(op == "translate" && readVec3(tokens, i + 1, v))
+            {
+                transform = glm::translate(transform, v);
+                i += 4;
+            }
+            else if(op == "rotate" && readNumber(tokens, i + 1, angle) && readVec3(tokens, i + 2, v))
+            {
+                transform = glm::rotate(transform, glm::radians(angle), v);
+                i += 5;
+            }
+            else if(op == "scale" && readVec3(tokens, i + 1, v))
+            {
+                transform = glm::scale(transform, v);
+                i += 4;
+            }
+            else if(op == "scale" && readNumber(tokens, i + 1, angle))
+            {
+                transform = glm::scale(transform, glm::vec3(angle));
+                i += 2;
+            }
+            else
+                return "bad transform at " + op;
+        }
+        return string();
+    }
+
+    // reads "<key> values..." pairs after the light's type. every key has a fixed number of values.
+    string parseLight(const vector<string> &tokens)
+    {
+        const string &type = tokens[1];
+        ScenePointLight point;
+        SceneDirectionLight direction;
+        SceneSpotLight spot;
+        for(size_t i = 2; i < tokens.size(); )
+        {
+            const string &key = tokens[i];
+            glm::vec3 v;
+            bool ok = readVec3(tokens, i + 1, v);
+            if(ok && key == "position" && type == "point")
+                point.position = v;
+            else if(ok && key == "direction" && type == "directional")
+                direction.direction = v;
+            else if(ok && key == "ambient")
+                point.ambient = direction.ambient = spot.ambient = v;
+            else if(ok && key == "diffuse")
+                point.diffuse = direction.diffuse = spot.diffuse = v;
+            else if(ok && key == "specular")
+                point.specular = direction.specular = spot.specular = v;
+            else if(ok && key == "attenuation" && type != "directional")
+            {
+                point.constant = spot.constant = v.x;
+                point.linear = spot.linear = v.y;
+                point.quadratic = spot.quadratic = v.z;
+            }
+            else if(key == "cutoff" && type == "spot" && readNumber(tokens, i + 1, spot.cutOff) && readNumber(tokens, i + 2, spot.outerCutOff))
+            {
+                i += 3;
+                continue;
+            }
+            else
+                return "bad " + type + " light property " + key;
+            i += 4;
+        }
+        if(type == "point")
+        {
+            if(pointLights.size() == maxPointLights)
+                return "more than " + to_string(maxPointLights) + " point lights";
+            pointLights.push_back(point);
+        }
+        else if(type == "directional")
+            directionLight = direction;
+        else if(type == "spot")
+            spotLight = spot;
+        else
+            return "unknown light type " + type;
+        return string();
+    }
+};
+#endif
@@ -8,61 +8,68 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 #include <common.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_source.h>
+#include <learnopengl/texture_slot.h>
+#include <learnopengl/trace.h>
+#include <learnopengl/uniform_buffer.h>
+
+// location of a uniform resolved once by name through Shader::uniform, set with Shader::set. the type parameter is
+// checked against the program's reflection when the handle is made. a handle of a uniform the program doesn't
+// have (optimized out, or not part of this pass) is invalid and setting it does nothing. a handle only works with the
+// program it was resolved on, setting it on another one is reported and ignored.
+template<typename T>
+struct UniformHandle
+{
+    GLint location = -1;
+    int slot = -1;      // index of the program's copy of the value, see Shader::changed
+    GLuint program = 0; // the program it was resolved on
+    bool valid() const { return location >= 0; }
+};
+
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // uniform traffic of all programs since the last reset. string based calls are counted so per frame code
+    // still going through names shows up.
+    struct UniformStats {
+        size_t nameLookups = 0;
+        size_t unknownNames = 0;     // names the program has no active uniform for
+        size_t uploads = 0;          // glUniform calls issued
+        size_t redundant = 0;        // sets skipped because the uniform already held the value
+    };
+    // constructor generates the shader on the fly. #include "name" lines are resolved against resources/shaders/ and
+    // defines ("#define NAME value" lines) are inserted into every stage right after its #version line, see
+    // ShaderSource and ShaderVariants.
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char* defines = nullptr)
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        TraceZone zone("shader", vertexPath);
+        // 1. retrieve the vertex/fragment source code from filePath, includes resolved and defines inserted
+        ShaderSource vertexSource, fragmentSource, geometrySource;
+        std::string definesString = defines != nullptr ? defines : "";
+        if(!vertexSource.Load(vertexPath, definesString) || !fragmentSource.Load(fragmentPath, definesString) ||
+           (geometryPath != nullptr && !geometrySource.Load(geometryPath, definesString)))
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        catch (std::ifstream::failure& e)
+        const std::string &vertexCode = vertexSource.code;
+        const std::string &fragmentCode = fragmentSource.code;
+        const std::string &geometryCode = geometrySource.code;
+        // a program linked from the same sources by the same driver is loaded straight from the binary cache
+        ID = glCreateProgram();
+        std::string cachePath = ProgramCache::PathFor(vertexPath, definesString);
+        uint64_t cacheKey = ProgramCache::Key(vertexCode, fragmentCode, geometryCode);
+        if(ProgramCache::Load(cachePath, cacheKey, ID))
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            reflectUniforms();
+            return;
         }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
@@ -72,12 +79,12 @@ public:
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        checkCompileErrors(vertex, "VERTEX", &vertexSource);
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        checkCompileErrors(fragment, "FRAGMENT", &fragmentSource);
         // if geometry shader is given, compile geometry shader
         unsigned int geometry;
         if(geometryPath != nullptr)
@@ -86,16 +93,18 @@ public:
             geometry = glCreateShader(GL_GEOMETRY_SHADER);
             glShaderSource(geometry, 1, &gShaderCode, NULL);
             glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            checkCompileErrors(geometry, "GEOMETRY", &geometrySource);
         }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         if(geometryPath != nullptr)
             glAttachShader(ID, geometry);
+        ProgramCache::PrepareForStore(ID);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        if(checkCompileErrors(ID, "PROGRAM"))
+            ProgramCache::Store(cachePath, cacheKey, ID);
+        reflectUniforms();
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -107,71 +116,269 @@ public:
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::UseProgram(ID); 
     }
-    // utility uniform functions
+    // typed uniform handles, resolved once and set without any name lookup
+    // ------------------------------------------------------------------------
+    template<typename T>
+    UniformHandle<T> uniform(const std::string &name) const
+    {
+        UniformHandle<T> handle;
+        auto it = uniforms.find(name);
+        if(it == uniforms.end())
+            return handle;
+        if(!acceptsType(it->second.type, T()))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << name << " has gl type 0x" << std::hex << it->second.type << std::dec << std::endl;
+            return handle;
+        }
+        handle.location = it->second.location;
+        handle.slot = it->second.slot;
+        handle.program = ID;
+        return handle;
+    }
+    void set(UniformHandle<bool> handle, bool value) const { int v = (int)value; if(changed(handle, v)) glUniform1i(handle.location, v); }
+    void set(UniformHandle<int> handle, int value) const { if(changed(handle, value)) glUniform1i(handle.location, value); }
+    void set(UniformHandle<float> handle, float value) const { if(changed(handle, value)) glUniform1f(handle.location, value); }
+    void set(UniformHandle<glm::vec2> handle, const glm::vec2 &value) const { if(changed(handle, value)) glUniform2fv(handle.location, 1, &value[0]); }
+    void set(UniformHandle<glm::vec3> handle, const glm::vec3 &value) const { if(changed(handle, value)) glUniform3fv(handle.location, 1, &value[0]); }
+    void set(UniformHandle<glm::vec4> handle, const glm::vec4 &value) const { if(changed(handle, value)) glUniform4fv(handle.location, 1, &value[0]); }
+    void set(UniformHandle<glm::mat2> handle, const glm::mat2 &mat) const { if(changed(handle, mat)) glUniformMatrix2fv(handle.location, 1, GL_FALSE, &mat[0][0]); }
+    void set(UniformHandle<glm::mat3> handle, const glm::mat3 &mat) const { if(changed(handle, mat)) glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]); }
+    void set(UniformHandle<glm::mat4> handle, const glm::mat4 &mat) const { if(changed(handle, mat)) glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]); }
+    // the uniforms Material::Bind sets, for materials named prefix + "texture_diffuse1" and so on. resolved on first
+    // use and kept; that first use also points the samplers at their fixed units (see TextureSlot), so the program
+    // has to be current.
+    // ------------------------------------------------------------------------
+    struct MaterialUniforms {
+        std::string prefix;
+        UniformHandle<glm::vec4> colors[TEXTURE_SLOT_COUNT];
+    };
+    const MaterialUniforms &materialUniforms(const std::string &prefix) const
+    {
+        for(const MaterialUniforms &resolved : materials)
+            if(resolved.prefix == prefix)
+                return resolved;
+        MaterialUniforms resolved;
+        resolved.prefix = prefix;
+        for(int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
+        {
+            set(uniform<int>(prefix + TextureSlotSampler((TextureSlot)slot)), slot);
+            if(TextureSlotColor((TextureSlot)slot) != nullptr)
+                resolved.colors[slot] = uniform<glm::vec4>(prefix + TextureSlotColor((TextureSlot)slot));
+        }
+        materials.push_back(resolved);
+        return materials.back();
+    }
+    // ------------------------------------------------------------------------
+    static UniformStats GetUniformStats() { return uniformStats(); }
+    static void ResetUniformStats() { uniformStats() = UniformStats(); }
+    // utility uniform functions. like the handles they skip the upload when the uniform already holds the value.
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        set(handleOf<bool>(name), value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        set(handleOf<int>(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        set(handleOf<float>(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(handleOf<glm::vec2>(name), value); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        set(handleOf<glm::vec2>(name), glm::vec2(x, y)); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(handleOf<glm::vec3>(name), value); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        set(handleOf<glm::vec3>(name), glm::vec3(x, y, z)); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(handleOf<glm::vec4>(name), value); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        set(handleOf<glm::vec4>(name), glm::vec4(x, y, z, w)); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(handleOf<glm::mat2>(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(handleOf<glm::mat3>(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(handleOf<glm::mat4>(name), mat);
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    struct UniformInfo {
+        GLint location;
+        GLenum type;
+        int slot;
+    };
+    // every active uniform by each name glGetUniformLocation would accept for it
+    std::unordered_map<std::string, UniformInfo> uniforms;
+    // last value uploaded to every uniform location of the program, so setting the same value twice is free. only
+    // valid while uniforms are written through this Shader, which is the only way the code writes them.
+    struct UniformValue {
+        unsigned char bytes[sizeof(glm::mat4)];
+        unsigned char size = 0;     // 0 until the first upload
+    };
+    mutable std::vector<UniformValue> values;
+    // one per material prefix drawn with the program
+    mutable std::vector<MaterialUniforms> materials;
+
+    static UniformStats &uniformStats()
+    {
+        static UniformStats stats;
+        return stats;
+    }
+
+    // looks up a uniform by name in the reflected table, an invalid handle if the program has none by that name.
+    // unlike uniform() the type is not checked, the setters have never done that.
+    template<typename T>
+    UniformHandle<T> handleOf(const std::string &name) const
+    {
+        UniformStats &stats = uniformStats();
+        stats.nameLookups++;
+        UniformHandle<T> handle;
+        auto it = uniforms.find(name);
+        if(it == uniforms.end())
+        {
+            stats.unknownNames++;
+            return handle;
+        }
+        handle.location = it->second.location;
+        handle.slot = it->second.slot;
+        handle.program = ID;
+        return handle;
+    }
+
+    // records value as the content of the handle's slot and returns true if that differs from what it held, i.e. if
+    // the caller has to upload it. false for invalid handles, there is nothing to upload to, and for handles of
+    // another program, whose location and slot mean nothing here.
+    template<typename T, typename V>
+    bool changed(const UniformHandle<T> &handle, const V &value) const
+    {
+        static_assert(sizeof(V) <= sizeof(glm::mat4), "uniform values are at most a mat4");
+        if(handle.slot < 0)
+            return false;
+        if(handle.program != ID || handle.slot >= (int)values.size())
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_HANDLE_OF_OTHER_PROGRAM resolved on " << handle.program << ", set on " << ID << std::endl;
+            return false;
+        }
+        UniformStats &stats = uniformStats();
+        UniformValue &cached = values[handle.slot];
+        if(cached.size == sizeof(V) && memcmp(cached.bytes, &value, sizeof(V)) == 0)
+        {
+            stats.redundant++;
+            return false;
+        }
+        memcpy(cached.bytes, &value, sizeof(V));
+        cached.size = (unsigned char)sizeof(V);
+        stats.uploads++;
+        return true;
+    }
+
+    // reads the active uniforms of the linked program. arrays are reported once as "name[0]", they are entered
+    // under their bare name and under every element.
+    void reflectUniforms()
+    {
+        uniforms.clear();
+        int slotCount = 0;
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+        for(GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            // members of uniform blocks have no location of their own
+            if(location < 0)
+                continue;
+            if(name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                for(GLint element = 0; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniforms[elementName] = UniformInfo{glGetUniformLocation(ID, elementName.c_str()), type, slotCount++};
+                }
+                // the bare name is the first element
+                uniforms[base] = uniforms[base + "[0]"];
+            }
+            else
+                uniforms[name] = UniformInfo{location, type, slotCount++};
+        }
+        values.assign(slotCount, UniformValue());
+        materials.clear();
+        bindUniformBlocks();
+    }
+
+    // points the shared uniform blocks at their fixed binding points (see UniformBlocks)
+    void bindUniformBlocks()
+    {
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        for(GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(ID, (GLuint)i, sizeof(name), &length, name);
+            int binding = UniformBlocks::BindingOf(std::string(name, length));
+            if(binding >= 0)
+                glUniformBlockBinding(ID, (GLuint)i, (GLuint)binding);
+            else
+                std::cout << "WARNING::SHADER:: uniform block " << std::string(name, length) << " has no binding point" << std::endl;
+        }
+    }
+
+    static bool acceptsType(GLenum type, bool) { return type == GL_BOOL || type == GL_INT; }
+    static bool acceptsType(GLenum type, int)
+    {
+        return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE ||
+               type == GL_SAMPLER_2D_SHADOW || type == GL_SAMPLER_CUBE_SHADOW || type == GL_SAMPLER_2D_ARRAY;
+    }
+    static bool acceptsType(GLenum type, float) { return type == GL_FLOAT; }
+    static bool acceptsType(GLenum type, const glm::vec2&) { return type == GL_FLOAT_VEC2; }
+    static bool acceptsType(GLenum type, const glm::vec3&) { return type == GL_FLOAT_VEC3; }
+    static bool acceptsType(GLenum type, const glm::vec4&) { return type == GL_FLOAT_VEC4; }
+    static bool acceptsType(GLenum type, const glm::mat2&) { return type == GL_FLOAT_MAT2; }
+    static bool acceptsType(GLenum type, const glm::mat3&) { return type == GL_FLOAT_MAT3; }
+    static bool acceptsType(GLenum type, const glm::mat4&) { return type == GL_FLOAT_MAT4; }
+
+    // utility function for checking shader compilation/linking errors, true if there were none. compile errors are
+    // reported against the files of source, includes and all.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type, const ShaderSource *source = nullptr)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -181,7 +388,8 @@ private:
             if(!success)
             {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                std::string log = source != nullptr ? source->Annotate(infoLog) : std::string(infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << log << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
         else
@@ -193,6 +401,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
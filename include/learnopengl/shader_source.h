@@ -0,0 +1,146 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// one shader stage as it is handed to the driver. #include "name" lines are replaced by the named file, resolved
+// against IncludeDirectory and included once per stage (the shared files also keep include guards, c++ reads them
+// too). defines go right after the #version line. #line directives keep the driver's line numbers pointing into the
+// original files, with the index into files as source string number, so Annotate can turn an info log back into
+// file:line.
+class ShaderSource
+{
+public:
+    string code;
+    vector<string> files;       // the stage's file first, then the includes in the order they were pulled in
+
+    static string &IncludeDirectory()
+    {
+        static string directory = "resources/shaders/";
+        return directory;
+    }
+
+    // reads path and everything it includes, false if a file could not be read. a missing include is reported here.
+    bool Load(const string &path, const string &defines = string())
+    {
+        code.clear();
+        files.clear();
+        bool versionSeen = false;
+        if(!append(path, defines, versionSeen))
+            return false;
+        // no #version, the defines go first
+        if(!versionSeen && !defines.empty())
+            code = defines + "#line 1 0\n" + code;
+        return true;
+    }
+
+    // rewrites the "source:line" references of an info log ("0:12(5): error" from mesa, "0(12) : error" from
+    // nvidia, "ERROR: 0:12:" from amd) to "file:line"
+    string Annotate(const string &log) const
+    {
+        static const regex reference("(^|[^\\w.])(\\d+)(?::(\\d+)|\\((\\d+)\\))");
+        istringstream lines(log);
+        string line, annotated;
+        while(getline(lines, line))
+        {
+            smatch match;
+            if(regex_search(line, match, reference))
+            {
+                size_t file = stoul(match[2].str());
+                string number = match[3].matched ? match[3].str() : match[4].str();
+                if(file < files.size())
+                    line = match.prefix().str() + match[1].str() + files[file] + ":" + number + match.suffix().str();
+            }
+            annotated += line + "\n";
+        }
+        return annotated;
+    }
+
+private:
+    bool append(const string &path, const string &defines, bool &versionSeen)
+    {
+        ifstream file(path);
+        if(!file)
+            return false;
+        const string index = to_string(files.size());
+        files.push_back(path);
+        string line;
+        int number = 0;
+        while(getline(file, line))
+        {
+            number++;
+            string name;
+            if(includeName(line, name))
+            {
+                string includePath = IncludeDirectory() + name;
+                if(!included(includePath))
+                {
+                    code += "#line 1 " + to_string(files.size()) + "\n";
+                    if(!append(includePath, string(), versionSeen))
+                    {
+                        cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << path << ":" << number << " " << name << endl;
+                        return false;
+                    }
+                }
+                code += "#line " + to_string(number + 1) + " " + index + "\n";
+                continue;
+            }
+            code += line;
+            code += '\n';
+            if(!versionSeen && !defines.empty() && isVersion(line))
+            {
+                versionSeen = true;
+                code += defines;
+                code += "#line " + to_string(number + 1) + " " + index + "\n";
+            }
+        }
+        return true;
+    }
+
+    bool included(const string &path) const
+    {
+        for(const string &file : files)
+            if(file == path)
+                return true;
+        return false;
+    }
+
+    static size_t directive(const string &line, const char *name)
+    {
+        size_t i = line.find_first_not_of(" \t");
+        if(i == string::npos || line[i] != '#')
+            return string::npos;
+        i = line.find_first_not_of(" \t", i + 1);
+        size_t length = strlen(name);
+        if(i == string::npos || line.compare(i, length, name) != 0)
+            return string::npos;
+        return i + length;
+    }
+
+    static bool isVersion(const string &line)
+    {
+        return directive(line, "version") != string::npos;
+    }
+
+    // the name of an #include "name" line
+    static bool includeName(const string &line, string &name)
+    {
+        size_t i = directive(line, "include");
+        if(i == string::npos)
+            return false;
+        size_t open = line.find('"', i);
+        size_t close = open == string::npos ? string::npos : line.find('"', open + 1);
+        if(close == string::npos)
+            return false;
+        name = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+};
+#endif
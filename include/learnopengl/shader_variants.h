@@ -0,0 +1,73 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <learnopengl/shader.h>
+#include <learnopengl/trace.h>
+
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// one compile time feature of a shader family: a #define whose value is read from bits of the variant key
+struct ShaderFeature {
+    string define;
+    unsigned int shift;
+    unsigned int bits;
+};
+
+// a family of programs built from the same sources, one per combination of feature values. every feature becomes
+// "#define NAME value" after the #version line, so the shader drops whatever is disabled with #if instead of
+// branching on uniforms at run time. variants are compiled on first use, or up front with Precompile, and kept;
+// each goes through the program binary cache like any other Shader.
+class ShaderVariants
+{
+public:
+    ShaderVariants(string vertexPath, string fragmentPath, string geometryPath, vector<ShaderFeature> features)
+        : vertexPath(std::move(vertexPath)), fragmentPath(std::move(fragmentPath)), geometryPath(std::move(geometryPath)),
+          features(std::move(features))
+    {
+    }
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    // the program for a variant key, compiled now if this is its first use
+    Shader &Get(unsigned int key)
+    {
+        auto it = variants.find(key);
+        if(it != variants.end())
+            return *it->second;
+        string defines = Defines(key);
+        TraceZone zone("shader variant", defines);
+        Shader *shader = new Shader(vertexPath.c_str(), fragmentPath.c_str(), geometryPath.empty() ? nullptr : geometryPath.c_str(),
+                                    defines.c_str());
+        variants[key].reset(shader);
+        return *shader;
+    }
+
+    void Precompile(initializer_list<unsigned int> keys)
+    {
+        for(unsigned int key : keys)
+            Get(key);
+    }
+
+    // the #define lines a variant is compiled with
+    string Defines(unsigned int key) const
+    {
+        string defines;
+        for(const ShaderFeature &feature : features)
+            defines += "#define " + feature.define + " " + to_string((key >> feature.shift) & ((1u << feature.bits) - 1)) + "\n";
+        return defines;
+    }
+
+    size_t Compiled() const { return variants.size(); }
+
+private:
+    string vertexPath, fragmentPath, geometryPath;
+    vector<ShaderFeature> features;
+    map<unsigned int, unique_ptr<Shader>> variants;
+};
+#endif
@@ -0,0 +1,309 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/image.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/mesh.h>
+
+// imgui compiles its copy of the packer static to imgui_draw.cpp, so this one is private to us as well
+#ifndef STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <imstb_rectpack.h>
+#undef STB_RECT_PACK_IMPLEMENTATION
+#undef STBRP_STATIC
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+// import pass cutting down the textures (and so the texture binds) of a model made of many small materials:
+//  - textures whose texels are all the same color become MaterialColor constants and are dropped from the mesh
+//  - small textures are packed into atlas pages and the uvs of the meshes using them are remapped into the page
+// a page is written next to the model as an uncompressed KTX image (<model>.atlas<N>.ktx), which the texture
+// loader then treats like any other source image (mips, compression, its own cache). only meshes with a single
+// texture whose uvs stay inside [0, 1] can be remapped, a texture used by any other mesh stays on its own.
+class TextureAtlas
+{
+public:
+    static const int PAGE_SIZE = 2048;
+    // textures larger than this in either dimension are left alone
+    static const int MAX_PACKED_SIZE = 512;
+    // texels of edge replicated around every packed texture, keeps bilinear filtering and the first mips from
+    // bleeding into the neighbours. also the block size, so compressed blocks never straddle two textures.
+    static const int PADDING = 4;
+    // largest difference to the mean, per channel, for a texture to still count as a single color
+    static const int SOLID_TOLERANCE = 2;
+
+    struct Stats {
+        size_t textures = 0;    // distinct textures before the pass
+        size_t constants = 0;   // turned into MaterialColor
+        size_t packed = 0;      // moved into pages
+        size_t pages = 0;
+    };
+
+    // key stored in the pages, Current compares it to spot pages left over from another import
+    static constexpr const char *SOURCE_KEY = "rg.atlasKey";
+
+    static string PagePath(const string &modelPath, size_t page)
+    {
+        return modelPath + ".atlas" + to_string(page) + ".ktx";
+    }
+
+    // runs the pass over freshly imported meshes and writes the pages. sourceKey identifies the import (see
+    // MeshCache::SourceKey) and is stored in the pages.
+    static Stats Build(const string &modelPath, vector<MeshData> &meshes, uint64_t sourceKey)
+    {
+        Stats stats;
+        string directory = modelPath.substr(0, modelPath.find_last_of('/'));
+        string modelName = modelPath.substr(modelPath.find_last_of('/') + 1);
+
+        map<string, Source> sources;
+        for(const MeshData &mesh : meshes)
+            for(const Texture &texture : mesh.textures)
+                sources[texture.path];
+        stats.textures = sources.size();
+        for(auto &entry : sources)
+        {
+            Source &source = entry.second;
+            if(!source.image.Load(directory + '/' + entry.first))
+                continue;
+            source.solid = solidColor(source.image, source.color);
+            source.packable = !source.solid && source.image.width <= MAX_PACKED_SIZE && source.image.height <= MAX_PACKED_SIZE;
+        }
+
+        // single color textures become constants
+        for(MeshData &mesh : meshes)
+        {
+            vector<Texture> kept;
+            for(const Texture &texture : mesh.textures)
+            {
+                const Source &source = sources[texture.path];
+                if(source.solid)
+                    mesh.colors.push_back(MaterialColor{texture.type, source.color});
+                else
+                    kept.push_back(texture);
+            }
+            mesh.textures.swap(kept);
+        }
+        for(const auto &entry : sources)
+            stats.constants += entry.second.solid ? 1 : 0;
+
+        // one uv set can only be remapped into one rectangle
+        for(const MeshData &mesh : meshes)
+            if(mesh.textures.size() > 1 || !uvsInUnitSquare(mesh))
+                for(const Texture &texture : mesh.textures)
+                    sources[texture.path].packable = false;
+
+        vector<string> pending;
+        for(auto &entry : sources)
+        {
+            if(entry.second.packable)
+                pending.push_back(entry.first);
+            else
+                entry.second.image = DecodedImage();
+        }
+        while(pending.size() > 1)
+        {
+            vector<stbrp_rect> rects(pending.size());
+            for(size_t i = 0; i < pending.size(); i++)
+            {
+                const DecodedImage &image = sources[pending[i]].image;
+                rects[i].id = (int)i;
+                rects[i].w = padded(image.width);
+                rects[i].h = padded(image.height);
+            }
+            stbrp_context context;
+            vector<stbrp_node> nodes(PAGE_SIZE);
+            stbrp_init_target(&context, PAGE_SIZE, PAGE_SIZE, nodes.data(), (int)nodes.size());
+            stbrp_pack_rects(&context, rects.data(), (int)rects.size());
+
+            vector<string> placed, rest;
+            int width = 0, height = 0;
+            for(const stbrp_rect &rect : rects)
+            {
+                if(!rect.was_packed)
+                {
+                    rest.push_back(pending[rect.id]);
+                    continue;
+                }
+                Source &source = sources[pending[rect.id]];
+                source.page = (int)stats.pages;
+                source.x = rect.x + PADDING;
+                source.y = rect.y + PADDING;
+                width = std::max(width, (int)(rect.x + rect.w));
+                height = std::max(height, (int)(rect.y + rect.h));
+                placed.push_back(pending[rect.id]);
+            }
+            // a page holding a single texture saves nothing
+            if(placed.size() < 2)
+            {
+                for(const string &path : placed)
+                    sources[path].page = -1;
+                break;
+            }
+            if(!writePage(PagePath(modelPath, stats.pages), sources, placed, width, height, sourceKey))
+            {
+                for(const string &path : placed)
+                    sources[path].page = -1;
+                break;
+            }
+            for(const string &path : placed)
+            {
+                sources[path].pageWidth = width;
+                sources[path].pageHeight = height;
+            }
+            stats.packed += placed.size();
+            stats.pages++;
+            pending.swap(rest);
+        }
+
+        for(MeshData &mesh : meshes)
+        {
+            if(mesh.textures.size() != 1)
+                continue;
+            const Source &source = sources[mesh.textures[0].path];
+            if(source.page < 0)
+                continue;
+            glm::vec2 offset(float(source.x) / source.pageWidth, float(source.y) / source.pageHeight);
+            glm::vec2 scale(float(source.image.width) / source.pageWidth, float(source.image.height) / source.pageHeight);
+            for(Vertex &vertex : mesh.vertices)
+                vertex.TexCoords = offset + glm::clamp(vertex.TexCoords, 0.0f, 1.0f) * scale;
+            mesh.textures[0].path = modelName + ".atlas" + to_string(source.page) + ".ktx";
+        }
+        return stats;
+    }
+
+    // whether every page the meshes reference exists and was written for the same import
+    static bool Current(const string &modelPath, const vector<MeshData> &meshes, uint64_t sourceKey)
+    {
+        string directory = modelPath.substr(0, modelPath.find_last_of('/'));
+        string modelName = modelPath.substr(modelPath.find_last_of('/') + 1);
+        string key = ContentHash::ToHex(sourceKey);
+        map<string, bool> checked;
+        for(const MeshData &mesh : meshes)
+            for(const Texture &texture : mesh.textures)
+            {
+                if(texture.path.compare(0, modelName.size() + 6, modelName + ".atlas") != 0 || checked.count(texture.path))
+                    continue;
+                KtxTexture page;
+                bool current = Ktx::Read(directory + '/' + texture.path, page, true) && page.keyValues[SOURCE_KEY] == key;
+                if(!current)
+                    return false;
+                checked[texture.path] = true;
+            }
+        return true;
+    }
+
+private:
+    struct Source {
+        DecodedImage image;
+        bool solid = false;
+        bool packable = false;
+        glm::vec4 color = glm::vec4(0.0f);
+        int page = -1;
+        int x = 0, y = 0;
+        int pageWidth = 0, pageHeight = 0;
+    };
+
+    // texture size with its border, rounded to whole blocks so every texture starts on a block boundary
+    static int padded(int size)
+    {
+        return (size + 2 * PADDING + 3) & ~3;
+    }
+
+    static bool solidColor(const DecodedImage &image, glm::vec4 &color)
+    {
+        size_t texels = size_t(image.width) * image.height;
+        int n = image.components;
+        int low[4] = {255, 255, 255, 255}, high[4] = {0, 0, 0, 0};
+        double sum[4] = {0.0, 0.0, 0.0, 0.0};
+        for(size_t i = 0; i < texels; i++)
+            for(int c = 0; c < n; c++)
+            {
+                int value = image.data[i * n + c];
+                low[c] = std::min(low[c], value);
+                high[c] = std::max(high[c], value);
+                sum[c] += value;
+            }
+        float mean[4] = {0.0f, 0.0f, 0.0f, 255.0f};
+        for(int c = 0; c < n; c++)
+        {
+            mean[c] = float(sum[c] / texels);
+            if(high[c] - mean[c] > SOLID_TOLERANCE || mean[c] - low[c] > SOLID_TOLERANCE)
+                return false;
+        }
+        // grey and grey + alpha images spread their first channel over rgb
+        if(n <= 2)
+        {
+            mean[3] = n == 2 ? mean[1] : 255.0f;
+            mean[1] = mean[2] = mean[0];
+        }
+        color = glm::vec4(mean[0], mean[1], mean[2], mean[3]) / 255.0f;
+        return true;
+    }
+
+    static bool uvsInUnitSquare(const MeshData &mesh)
+    {
+        const float epsilon = 1e-3f;
+        for(const Vertex &vertex : mesh.vertices)
+            if(vertex.TexCoords.x < -epsilon || vertex.TexCoords.x > 1.0f + epsilon ||
+               vertex.TexCoords.y < -epsilon || vertex.TexCoords.y > 1.0f + epsilon)
+                return false;
+        return true;
+    }
+
+    static void texel(const DecodedImage &image, int x, int y, unsigned char *rgba)
+    {
+        const unsigned char *p = image.data + (size_t(y) * image.width + x) * image.components;
+        switch(image.components)
+        {
+            case 1: rgba[0] = rgba[1] = rgba[2] = p[0]; rgba[3] = 255; break;
+            case 2: rgba[0] = rgba[1] = rgba[2] = p[0]; rgba[3] = p[1]; break;
+            case 3: rgba[0] = p[0]; rgba[1] = p[1]; rgba[2] = p[2]; rgba[3] = 255; break;
+            default: rgba[0] = p[0]; rgba[1] = p[1]; rgba[2] = p[2]; rgba[3] = p[3]; break;
+        }
+    }
+
+    // copies the placed textures into an RGBA page, filling every border with the nearest edge texel
+    static bool writePage(const string &path, map<string, Source> &sources, const vector<string> &placed, int width, int height, uint64_t sourceKey)
+    {
+        KtxTexture page;
+        page.glInternalFormat = GL_RGBA8;
+        page.glFormat = GL_RGBA;
+        page.glType = GL_UNSIGNED_BYTE;
+        page.width = width;
+        page.height = height;
+        page.levels.emplace_back(size_t(width) * height * 4, 0);
+        unsigned char *pixels = page.levels[0].data();
+        for(const string &name : placed)
+        {
+            const Source &source = sources[name];
+            const DecodedImage &image = source.image;
+            int left = source.x - PADDING, top = source.y - PADDING;
+            int right = std::min(width, left + padded(image.width)), bottom = std::min(height, top + padded(image.height));
+            for(int y = top; y < bottom; y++)
+                for(int x = left; x < right; x++)
+                {
+                    int sx = std::min(std::max(x - source.x, 0), image.width - 1);
+                    int sy = std::min(std::max(y - source.y, 0), image.height - 1);
+                    texel(image, sx, sy, pixels + (size_t(y) * width + x) * 4);
+                }
+        }
+        page.keyValues[SOURCE_KEY] = ContentHash::ToHex(sourceKey);
+        return Ktx::Write(path, page);
+    }
+};
+
+constexpr const char *TextureAtlas::SOURCE_KEY;
+#endif
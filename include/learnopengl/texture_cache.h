@@ -0,0 +1,200 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/texture_loader.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// process wide cache of 2D textures shared by every Model. textures are found by normalized file path and, after
+// loading, by a hash of their base level, so the same image under two names is uploaded only once. every Acquire
+// takes a reference, the texture is deleted when the last one is released.
+// lookups are thread safe; acquiring and releasing touch gl and belong on the context thread.
+class TextureCache
+{
+public:
+    struct Stats {
+        unsigned int textures = 0;      // distinct gl textures alive
+        unsigned int pathHits = 0;      // acquires served by path, nothing decoded
+        unsigned int contentHits = 0;   // decoded images that turned out to be duplicates of a resident texture
+        size_t residentBytes = 0;       // gpu memory of the resident textures, mip chain included
+        size_t savedBytes = 0;          // gpu memory deduplication avoided uploading
+    };
+
+    static TextureCache &Instance()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    // folds '\' into '/' and resolves "." and ".." components, so different spellings of a path share an entry
+    static string NormalizePath(const string &path)
+    {
+        vector<string> parts;
+        string part;
+        bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+        for(size_t i = 0; i <= path.size(); i++)
+        {
+            char c = i < path.size() ? path[i] : '/';
+            if(c != '/' && c != '\\')
+            {
+                part += c;
+                continue;
+            }
+            if(part == "..")
+            {
+                if(!parts.empty() && parts.back() != "..")
+                    parts.pop_back();
+                else if(!absolute)
+                    parts.push_back(part);
+            }
+            else if(!part.empty() && part != ".")
+                parts.push_back(part);
+            part.clear();
+        }
+        string normalized = absolute ? "/" : "";
+        for(size_t i = 0; i < parts.size(); i++)
+        {
+            if(i > 0)
+                normalized += '/';
+            normalized += parts[i];
+        }
+        return normalized;
+    }
+
+    // identity of the loaded texture, including the format and upload settings that change the resulting texture
+    static uint64_t ContentKey(const KtxTexture &texture, bool gamma)
+    {
+        if(!texture.Valid())
+            return 0;
+        uint64_t shape = (uint64_t(texture.width) << 32) ^ (uint64_t(texture.height) << 8) ^ (uint64_t(texture.glInternalFormat) << 40) ^
+                         (uint64_t(texture.levels.size()) << 1) ^ (gamma ? 1 : 0);
+        return ContentHash::Bytes(texture.levels[0].data(), texture.levels[0].size(), shape);
+    }
+
+    bool Contains(const string &normalizedPath)
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        return byPath.count(normalizedPath) != 0;
+    }
+
+    // texture id for a path that was loaded before, with a new reference taken. 0 if the path isn't resident.
+    unsigned int AcquireByPath(const string &normalizedPath)
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = byPath.find(normalizedPath);
+        if(it == byPath.end())
+            return 0;
+        Entry &entry = entries[it->second];
+        entry.refs++;
+        stats.pathHits++;
+        stats.savedBytes += entry.bytes;
+        return entry.id;
+    }
+
+    // takes a reference on the texture holding the given data, uploading it only if no resident texture has the
+    // same content. the path becomes an alias of that texture either way.
+    unsigned int AcquireLoaded(const string &normalizedPath, const KtxTexture &texture, uint64_t contentKey)
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto pathIt = byPath.find(normalizedPath);
+        if(pathIt != byPath.end())
+        {
+            Entry &entry = entries[pathIt->second];
+            entry.refs++;
+            stats.pathHits++;
+            stats.savedBytes += entry.bytes;
+            return entry.id;
+        }
+        if(texture.Valid())
+        {
+            auto contentIt = byContent.find(contentKey);
+            if(contentIt != byContent.end())
+            {
+                Entry &entry = entries[contentIt->second];
+                entry.refs++;
+                entry.paths.push_back(normalizedPath);
+                byPath[normalizedPath] = entry.id;
+                stats.contentHits++;
+                stats.savedBytes += entry.bytes;
+                return entry.id;
+            }
+        }
+
+        Entry entry;
+        entry.id = TextureFromKtx(texture);
+        entry.contentKey = contentKey;
+        entry.hasContent = texture.Valid();
+        entry.alpha = TextureLoader::HasAlpha(texture);
+        entry.bytes = texture.Bytes();
+        entry.refs = 1;
+        entry.paths.push_back(normalizedPath);
+        byPath[normalizedPath] = entry.id;
+        if(entry.hasContent)
+            byContent[contentKey] = entry.id;
+        stats.textures++;
+        stats.residentBytes += entry.bytes;
+        unsigned int id = entry.id;
+        entries[id] = std::move(entry);
+        return id;
+    }
+
+    // drops a reference, deleting the gl texture with the last one
+    void Release(unsigned int id)
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = entries.find(id);
+        if(it == entries.end() || --it->second.refs > 0)
+            return;
+        Entry &entry = it->second;
+        for(const string &path : entry.paths)
+            byPath.erase(path);
+        if(entry.hasContent)
+            byContent.erase(entry.contentKey);
+        stats.textures--;
+        stats.residentBytes -= entry.bytes;
+        GLState::DeleteTexture(entry.id);
+        entries.erase(it);
+    }
+
+    // whether the resident texture has texels that aren't opaque, see TextureLoader::HasAlpha
+    bool HasAlpha(unsigned int id)
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = entries.find(id);
+        return it != entries.end() && it->second.alpha;
+    }
+
+    Stats GetStats()
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        return stats;
+    }
+
+private:
+    struct Entry {
+        unsigned int id = 0;
+        uint64_t contentKey = 0;
+        bool hasContent = false;
+        bool alpha = false;
+        size_t bytes = 0;
+        unsigned int refs = 0;
+        vector<string> paths;
+    };
+
+    mutex cacheMutex;
+    unordered_map<unsigned int, Entry> entries;
+    unordered_map<string, unsigned int> byPath;
+    unordered_map<uint64_t, unsigned int> byContent;
+    Stats stats;
+
+    TextureCache() {}
+};
+#endif
@@ -0,0 +1,188 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/bcn.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/mip_chain.h>
+#include <learnopengl/thread_pool.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+// picks a block compressed format for an image and encodes it, mip chain included, into a KtxTexture.
+// which formats are allowed depends on the driver, so DetectSupport has to run on the context thread before any
+// texture is loaded; everything else is plain cpu work and safe on workers.
+class TextureCompression
+{
+public:
+    enum Mode {
+        OFF,    // upload uncompressed, as before
+        BC,     // BC1 for opaque color, BC3 with alpha
+        BC7     // BC7 for all color textures, BC1/BC3 where the driver lacks BPTC
+    };
+
+    // read from RG_TEXTURE_COMPRESSION (off, bc, bc7), defaults to bc
+    static Mode GetMode()
+    {
+        int mode = modeSetting().load();
+        if(mode < 0)
+        {
+            mode = BC;
+            const char *env = getenv("RG_TEXTURE_COMPRESSION");
+            if(env && strcmp(env, "off") == 0)
+                mode = OFF;
+            else if(env && strcmp(env, "bc7") == 0)
+                mode = BC7;
+            modeSetting().store(mode);
+        }
+        return (Mode)mode;
+    }
+
+    static void SetMode(Mode mode)
+    {
+        modeSetting().store(mode);
+    }
+
+    // queries the extensions of the current context. RGTC (BC4/BC5) is core since 3.0, S3TC and BPTC are not.
+    static void DetectSupport()
+    {
+        bool s3tc = false, bptc = false;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for(GLint i = 0; i < count; i++)
+        {
+            const char *name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if(!name)
+                continue;
+            if(strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+                s3tc = true;
+            else if(strcmp(name, "GL_ARB_texture_compression_bptc") == 0)
+                bptc = true;
+        }
+        supportFlags().store((s3tc ? SUPPORT_S3TC : 0) | (bptc ? SUPPORT_BPTC : 0) | SUPPORT_DETECTED);
+    }
+
+    // stable description of what Choose can return, part of the cache key of encoded textures
+    static unsigned int Profile()
+    {
+        return (unsigned int)GetMode() | (supportFlags().load() << 4);
+    }
+
+    // internal format for an image with the given channels, 0 to keep it uncompressed
+    static GLenum Choose(const unsigned char *pixels, int width, int height, int components)
+    {
+        int support = supportFlags().load();
+        Mode mode = GetMode();
+        if(mode == OFF || !(support & SUPPORT_DETECTED))
+            return 0;
+        if(components == 1)
+            return GL_COMPRESSED_RED_RGTC1;
+        if(components == 2)
+            return GL_COMPRESSED_RG_RGTC2;
+        if(mode == BC7 && (support & SUPPORT_BPTC))
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        if(!(support & SUPPORT_S3TC))
+            return 0;
+        if(components == 4 && HasAlpha(pixels, size_t(width) * height))
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+
+    // whether any texel of an RGBA image is less than opaque
+    static bool HasAlpha(const unsigned char *rgba, size_t texels)
+    {
+        for(size_t i = 0; i < texels; i++)
+            if(rgba[i * 4 + 3] != 255)
+                return true;
+        return false;
+    }
+
+    static size_t BlockBytes(GLenum format)
+    {
+        return format == GL_COMPRESSED_RED_RGTC1 || format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+    }
+
+    static size_t LevelBytes(GLenum format, int width, int height)
+    {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    // one level compressed into format, block rows spread over the pool when one is given
+    static vector<unsigned char> EncodeLevel(const MipLevel &level, int components, GLenum format, ThreadPool *pool)
+    {
+        int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+        size_t blockBytes = BlockBytes(format);
+        vector<unsigned char> out(size_t(blocksX) * blocksY * blockBytes);
+        auto encodeRow = [&](size_t by) {
+            unsigned char block[64];
+            for(int bx = 0; bx < blocksX; bx++)
+            {
+                BCn::FetchBlock(level.pixels.data(), level.width, level.height, components, bx, (int)by, block);
+                unsigned char *dst = &out[(by * blocksX + bx) * blockBytes];
+                switch(format)
+                {
+                    case GL_COMPRESSED_RED_RGTC1: BCn::EncodeBC4(block, 0, dst); break;
+                    case GL_COMPRESSED_RG_RGTC2: BCn::EncodeBC5(block, dst); break;
+                    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: BCn::EncodeBC1(block, dst); break;
+                    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: BCn::EncodeBC3(block, dst); break;
+                    default: BCn::EncodeBC7(block, dst); break;
+                }
+            }
+        };
+        // small levels aren't worth the scheduling
+        if(pool && blocksX * blocksY >= 256)
+            pool->ParallelFor(0, blocksY, encodeRow);
+        else
+            for(int by = 0; by < blocksY; by++)
+                encodeRow(by);
+        return out;
+    }
+
+    // the whole chain encoded in format, or stored as plain bytes if format is 0
+    static KtxTexture Encode(const vector<MipLevel> &chain, int components, GLenum format, ThreadPool *pool = nullptr)
+    {
+        KtxTexture texture;
+        texture.width = chain[0].width;
+        texture.height = chain[0].height;
+        if(format == 0)
+        {
+            static const GLenum formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+            texture.glFormat = texture.glInternalFormat = formats[components - 1];
+            texture.glType = GL_UNSIGNED_BYTE;
+            for(const MipLevel &level : chain)
+                texture.levels.push_back(level.pixels);
+            return texture;
+        }
+        texture.glInternalFormat = format;
+        for(const MipLevel &level : chain)
+            texture.levels.push_back(EncodeLevel(level, components, format, pool));
+        return texture;
+    }
+
+private:
+    enum {
+        SUPPORT_DETECTED = 1,
+        SUPPORT_S3TC = 2,
+        SUPPORT_BPTC = 4
+    };
+
+    static atomic<int> &modeSetting()
+    {
+        static atomic<int> mode(-1);
+        return mode;
+    }
+
+    static atomic<int> &supportFlags()
+    {
+        static atomic<int> flags(0);
+        return flags;
+    }
+
+};
+#endif
@@ -0,0 +1,192 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/image.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mip_chain.h>
+#include <learnopengl/texture_compression.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+unsigned int TextureFromKtx(const KtxTexture &texture, GLint wrap = GL_REPEAT);
+
+// cpu side of loading a texture file. the image is decoded once, its mip chain built on the cpu and, when the
+// driver and settings allow it, block compressed; the result is cached in a KTX file next to the source
+// (<source>.ktx), keyed by a hash of the source bytes and every setting that shaped it, so later loads only map
+// that file. besides the formats stb_image reads, the source may be an uncompressed single level KTX image (the
+// pages TextureAtlas writes). touches no gl state, safe on worker threads.
+class TextureLoader
+{
+public:
+    // bump whenever the encoders or the mip filters change what ends up in the cache
+    static const uint32_t VERSION = 3;
+
+    static string CachePathFor(const string &source)
+    {
+        return source + ".ktx";
+    }
+
+    // fills texture with the image at path and its full mip chain, compressed if possible. the pool, if given,
+    // spreads the mip filtering and encoding of a cache miss over its workers.
+    static bool Load(const string &path, bool flipVertically, KtxTexture &texture, const MipSettings &mips = MipSettings(), ThreadPool *pool = nullptr)
+    {
+        texture = KtxTexture();
+        MappedFile source(path);
+        if(!source.IsOpen())
+            return false;
+        uint64_t settings = (uint64_t(VERSION) << 48) | (uint64_t(TextureCompression::Profile()) << 16) |
+                            (uint64_t(mips.filter) << 4) | (mips.srgb ? 4 : 0) | (mips.preserveAlphaCoverage ? 2 : 0) | (flipVertically ? 1 : 0);
+        settings = ContentHash::Combine(settings, uint64_t(mips.alphaCutoff * 65535.0f));
+        string key = ContentHash::ToHex(ContentHash::Combine(ContentHash::Bytes(source.Data(), source.Size()), settings));
+        source.Close();
+
+        string cachePath = CachePathFor(path);
+        if(Ktx::Read(cachePath, texture))
+        {
+            auto it = texture.keyValues.find(SOURCE_KEY);
+            if(it != texture.keyValues.end() && it->second == key && texture.Valid())
+                return true;
+            texture = KtxTexture();
+        }
+
+        DecodedImage image;
+        KtxTexture ktxSource;
+        const unsigned char *pixels = nullptr;
+        int width = 0, height = 0, components = 0;
+        if(IsKtx(path))
+        {
+            if(!loadKtxSource(path, flipVertically, ktxSource, components))
+                return false;
+            pixels = ktxSource.levels[0].data();
+            width = ktxSource.width;
+            height = ktxSource.height;
+        }
+        else
+        {
+            if(!image.Load(path, flipVertically))
+                return false;
+            pixels = image.data;
+            width = image.width;
+            height = image.height;
+            components = image.components;
+        }
+        GLenum format = TextureCompression::Choose(pixels, width, height, components);
+        vector<MipLevel> chain = MipChain::Build(pixels, width, height, components, mips, pool);
+        // format 0 keeps the chain uncompressed, the fallback when compression is off or unsupported
+        texture = TextureCompression::Encode(chain, components, format, pool);
+        texture.keyValues[SOURCE_KEY] = key;
+        texture.keyValues[COMPONENTS_KEY] = to_string(components);
+        texture.keyValues[ALPHA_KEY] = components == 4 && TextureCompression::HasAlpha(pixels, size_t(width) * height) ? "1" : "0";
+        // not being able to write the cache (read-only install) only costs the work next time
+        Ktx::Write(cachePath, texture);
+        return true;
+    }
+
+    // channel count of the image the texture was made from, compression may have padded it
+    static int SourceComponents(const KtxTexture &texture)
+    {
+        auto it = texture.keyValues.find(COMPONENTS_KEY);
+        return it != texture.keyValues.end() ? atoi(it->second.c_str()) : 0;
+    }
+
+    // whether the source image had texels that aren't opaque. only RGBA sources count, the alpha the sampler
+    // returns for fewer channels is always 1.
+    static bool HasAlpha(const KtxTexture &texture)
+    {
+        auto it = texture.keyValues.find(ALPHA_KEY);
+        return it != texture.keyValues.end() && it->second == "1";
+    }
+
+    // decoded size of the source at path without decoding it, 0 if it isn't readable
+    static size_t PeekBytes(const string &path)
+    {
+        if(!IsKtx(path))
+            return DecodedImage::PeekBytes(path);
+        KtxTexture header;
+        if(!Ktx::Read(path, header, true))
+            return 0;
+        return size_t(header.width) * header.height * 4;
+    }
+
+    static bool IsKtx(const string &path)
+    {
+        return path.size() > 4 && path.compare(path.size() - 4, 4, ".ktx") == 0;
+    }
+
+private:
+    static constexpr const char *SOURCE_KEY = "rg.sourceKey";
+    static constexpr const char *COMPONENTS_KEY = "rg.components";
+    static constexpr const char *ALPHA_KEY = "rg.alpha";
+
+    // base level of an uncompressed 8 bit KTX image, as the pixels stb_image would have returned
+    static bool loadKtxSource(const string &path, bool flipVertically, KtxTexture &source, int &components)
+    {
+        if(!Ktx::Read(path, source) || !source.Valid() || source.Compressed() || source.glType != GL_UNSIGNED_BYTE)
+            return false;
+        switch(source.glFormat)
+        {
+            case GL_RED: components = 1; break;
+            case GL_RG: components = 2; break;
+            case GL_RGB: components = 3; break;
+            case GL_RGBA: components = 4; break;
+            default: return false;
+        }
+        vector<unsigned char> &data = source.levels[0];
+        size_t rowBytes = size_t(source.width) * components;
+        if(data.size() < rowBytes * source.height)
+            return false;
+        if(flipVertically)
+            for(int y = 0; y < source.height / 2; y++)
+                std::swap_ranges(data.begin() + y * rowBytes, data.begin() + (y + 1) * rowBytes, data.begin() + (source.height - 1 - y) * rowBytes);
+        return true;
+    }
+};
+
+constexpr const char *TextureLoader::SOURCE_KEY;
+constexpr const char *TextureLoader::COMPONENTS_KEY;
+constexpr const char *TextureLoader::ALPHA_KEY;
+
+// uploads every level the texture carries, the driver generates nothing
+unsigned int TextureFromKtx(const KtxTexture &texture, GLint wrap)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (texture.Valid())
+    {
+        GLState::BindTexture(GL_TEXTURE_2D, textureID);
+        // mip levels of RGB images have rows that aren't 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        int width = texture.width, height = texture.height;
+        for (size_t level = 0; level < texture.levels.size(); level++)
+        {
+            const vector<unsigned char> &data = texture.levels[level];
+            if (texture.Compressed())
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, texture.glInternalFormat, width, height, 0, (GLsizei)data.size(), data.data());
+            else
+                glTexImage2D(GL_TEXTURE_2D, (GLint)level, texture.glInternalFormat, width, height, 0, texture.glFormat, texture.glType, data.data());
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levels.size() - 1);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    return textureID;
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef TEXTURE_SLOT_H
+#define TEXTURE_SLOT_H
+
+#include <string>
+
+// the kinds of material texture. each has a fixed texture unit, the slot itself, so a program's material samplers
+// are pointed at their units once (Shader::materialUniforms) and binding a material is just binding its textures.
+// units from MATERIAL_TEXTURE_UNITS up are free for everything else (the shadow maps).
+enum TextureSlot {
+    TEXTURE_DIFFUSE,
+    TEXTURE_SPECULAR,
+    TEXTURE_NORMAL,
+    TEXTURE_HEIGHT,
+    TEXTURE_SLOT_COUNT
+};
+
+const unsigned int MATERIAL_TEXTURE_UNITS = TEXTURE_SLOT_COUNT;
+
+// the Texture::type the importers write for each slot ("texture_diffuse", ...)
+inline const char *TextureSlotType(TextureSlot slot)
+{
+    static const char *types[TEXTURE_SLOT_COUNT] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+    return types[slot];
+}
+
+// TEXTURE_SLOT_COUNT for types no slot takes
+inline TextureSlot TextureSlotOf(const std::string &type)
+{
+    for(int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
+        if(type == TextureSlotType((TextureSlot)slot))
+            return (TextureSlot)slot;
+    return TEXTURE_SLOT_COUNT;
+}
+
+// name of the slot's sampler and of the constant color standing in for a collapsed texture (nullptr for slots the
+// shaders have no color for), relative to the material prefix
+inline const char *TextureSlotSampler(TextureSlot slot)
+{
+    static const char *samplers[TEXTURE_SLOT_COUNT] = {"texture_diffuse1", "texture_specular1", "texture_normal1", "texture_height1"};
+    return samplers[slot];
+}
+
+inline const char *TextureSlotColor(TextureSlot slot)
+{
+    static const char *colors[TEXTURE_SLOT_COUNT] = {"diffuseColor", "specularColor", nullptr, nullptr};
+    return colors[slot];
+}
+#endif
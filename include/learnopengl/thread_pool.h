@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <learnopengl/trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed size pool of worker threads pulling jobs from a single fifo queue.
+// jobs must not touch gl state, there is no context current on the workers.
+class ThreadPool
+{
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if(threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, i]() {
+                Trace::SetThreadName("worker " + std::to_string(i + 1));
+                workerLoop();
+            });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int Size() const { return (unsigned int)workers.size(); }
+
+    // queues a job and returns a future for its result. exceptions thrown by the job end up in the future.
+    template<typename F>
+    auto Submit(F job) -> std::future<decltype(job())>
+    {
+        typedef decltype(job()) Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.emplace_back([task]() { (*task)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    // runs body(i) for every i in [begin, end) split into contiguous chunks across the pool and the calling thread,
+    // returns once all of them are done. safe to call from inside a job: while waiting the caller keeps draining the queue.
+    template<typename F>
+    void ParallelFor(size_t begin, size_t end, F body)
+    {
+        if(begin >= end)
+            return;
+        size_t chunks = std::min<size_t>(end - begin, Size() + 1);
+        size_t chunkSize = (end - begin + chunks - 1) / chunks;
+        std::vector<std::future<void>> pending;
+        for(size_t start = begin + chunkSize; start < end; start += chunkSize)
+        {
+            size_t stop = std::min(end, start + chunkSize);
+            pending.push_back(Submit([&body, start, stop]() {
+                for(size_t i = start; i < stop; i++)
+                    body(i);
+            }));
+        }
+        for(size_t i = begin; i < std::min(end, begin + chunkSize); i++)
+            body(i);
+        for(std::future<void> &f : pending)
+        {
+            // once the queue is empty every remaining chunk is already running on some thread, so blocking is safe
+            while(f.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                if(!runOne())
+                    break;
+            }
+            f.get();
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    bool runOne()
+    {
+        std::function<void()> job;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(jobs.empty())
+                return false;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+        return true;
+    }
+
+    void workerLoop()
+    {
+        for(;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if(stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+#endif
@@ -0,0 +1,220 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+// scoped timing zones written as a chrome://tracing / Perfetto json file. meant for startup: Start turns recording
+// on when a file is asked for, Finish writes it and turns recording off again, so zones left in per frame code
+// cost a single atomic load afterwards. every thread appends to its own buffer, the workers of the loader pools
+// show up as separate tracks next to the main thread.
+//
+//     TraceZone zone("import", path);     // recorded from here to the end of the scope
+class Trace
+{
+public:
+    // starts recording into the given file, or into the one named by RG_TRACE if path is empty. does nothing
+    // if neither names a file.
+    static void Start(const string &path = string())
+    {
+        string output = path;
+        if(output.empty())
+        {
+            const char *env = getenv("RG_TRACE");
+            if(env)
+                output = env;
+        }
+        if(output.empty())
+            return;
+        {
+            lock_guard<mutex> lock(registry().lock);
+            registry().path = output;
+        }
+        Now();
+        enabled().store(true, memory_order_release);
+    }
+
+    static bool Enabled()
+    {
+        return enabled().load(memory_order_relaxed);
+    }
+
+    // the track name of the calling thread. kept even while not recording.
+    static void SetThreadName(const string &name)
+    {
+        ThreadBuffer &buffer = threadBuffer();
+        lock_guard<mutex> lock(buffer.lock);
+        buffer.name = name;
+    }
+
+    // microseconds since the first call
+    static uint64_t Now()
+    {
+        static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+        return (uint64_t)chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - epoch).count();
+    }
+
+    static void Record(const char *name, const string &detail, uint64_t start, uint64_t end)
+    {
+        if(!Enabled())
+            return;
+        ThreadBuffer &buffer = threadBuffer();
+        lock_guard<mutex> lock(buffer.lock);
+        buffer.events.push_back(Event{name, detail, start, end - start});
+    }
+
+    // stops recording and writes everything recorded so far. returns false if nothing was recorded or the file
+    // could not be written.
+    static bool Finish()
+    {
+        if(!enabled().exchange(false))
+            return false;
+        Registry &r = registry();
+        lock_guard<mutex> lock(r.lock);
+        ofstream out(r.path, ios::trunc);
+        if(!out)
+        {
+            cout << "ERROR::TRACE:: could not write " << r.path << endl;
+            return false;
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for(const shared_ptr<ThreadBuffer> &buffer : r.buffers)
+        {
+            lock_guard<mutex> bufferLock(buffer->lock);
+            if(buffer->events.empty())
+                continue;
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+            first = false;
+            for(const Event &event : buffer->events)
+            {
+                out << ",\n{\"name\":\"" << escape(event.name) << "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << buffer->id << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+                if(!event.detail.empty())
+                    out << ",\"args\":{\"detail\":\"" << escape(event.detail) << "\"}";
+                out << "}";
+            }
+            buffer->events.clear();
+        }
+        out << "\n]}\n";
+        return (bool)out;
+    }
+
+    static string Path()
+    {
+        lock_guard<mutex> lock(registry().lock);
+        return registry().path;
+    }
+
+private:
+    struct Event {
+        const char *name;       // string literal, zones never own their name
+        string detail;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    // only its own thread appends, the lock is taken by Finish and is otherwise uncontended
+    struct ThreadBuffer {
+        mutex lock;
+        unsigned int id = 0;
+        string name;
+        vector<Event> events;
+    };
+
+    struct Registry {
+        mutex lock;
+        string path;
+        // shared with the threads, a buffer outlives its thread so late writers are still flushed
+        vector<shared_ptr<ThreadBuffer>> buffers;
+    };
+
+    static atomic<bool> &enabled()
+    {
+        static atomic<bool> value(false);
+        return value;
+    }
+
+    static Registry &registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    static ThreadBuffer &threadBuffer()
+    {
+        thread_local shared_ptr<ThreadBuffer> buffer;
+        if(!buffer)
+        {
+            buffer = make_shared<ThreadBuffer>();
+            Registry &r = registry();
+            lock_guard<mutex> lock(r.lock);
+            buffer->id = (unsigned int)r.buffers.size() + 1;
+            buffer->name = "thread " + to_string(buffer->id);
+            r.buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    static string escape(const string &s)
+    {
+        string result;
+        result.reserve(s.size());
+        for(char c : s)
+        {
+            if(c == '"' || c == '\\')
+                result += '\\';
+            if((unsigned char)c < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                result += code;
+            }
+            else
+                result += c;
+        }
+        return result;
+    }
+};
+
+// records the time from construction to destruction as one zone of the calling thread
+class TraceZone
+{
+public:
+    explicit TraceZone(const char *name, const string &detail = string())
+        : name(name), active(Trace::Enabled())
+    {
+        if(active)
+        {
+            this->detail = detail;
+            start = Trace::Now();
+        }
+    }
+
+    ~TraceZone()
+    {
+        if(active)
+            Trace::Record(name, detail, start, Trace::Now());
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char *name;
+    string detail;
+    uint64_t start = 0;
+    bool active;
+};
+#endif
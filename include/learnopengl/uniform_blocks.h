@@ -0,0 +1,21 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// c++ mirrors of the std140 uniform blocks in the shaders, generated from the same declarations the shaders include
+// (see resources/shaders/std140.glsl). CameraBlock, PointLightBlock, DirectionLightBlock, SpotLightBlock and
+// LightsBlock, plus LIGHTS_BLOCK_POINT_LIGHTS.
+#include "../../resources/shaders/camera.glsl"
+#include "../../resources/shaders/lights.glsl"
+
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock does not match the std140 layout");
+static_assert(sizeof(PointLightBlock) == 64, "PointLightBlock does not match the std140 layout");
+static_assert(sizeof(DirectionLightBlock) == 64, "DirectionLightBlock does not match the std140 layout");
+static_assert(offsetof(DirectionLightBlock, specular) == 48, "DirectionLightBlock does not match the std140 layout");
+static_assert(sizeof(SpotLightBlock) == 96, "SpotLightBlock does not match the std140 layout");
+static_assert(offsetof(SpotLightBlock, spotSwitch) == 80, "SpotLightBlock does not match the std140 layout");
+static_assert(sizeof(LightsBlock) == 288, "LightsBlock does not match the std140 layout");
+#endif
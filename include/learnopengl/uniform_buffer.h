@@ -0,0 +1,111 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+using namespace std;
+
+// fixed binding points of the uniform blocks shared between programs. Shader binds every block it finds by name
+// after linking (glsl 330 has no layout(binding = N)), so a new program only has to declare the block.
+enum UniformBinding {
+    CAMERA_BINDING = 0,
+    LIGHTS_BINDING = 1
+};
+
+struct UniformBlocks
+{
+    // binding point of a block name, -1 for blocks that are not shared
+    static int BindingOf(const string &blockName)
+    {
+        if(blockName == "Camera")
+            return CAMERA_BINDING;
+        if(blockName == "Lights")
+            return LIGHTS_BINDING;
+        return -1;
+    }
+};
+
+// a uniform buffer mirroring one std140 block. write into data and call Update once per frame. data is compared
+// against a copy of what the buffer holds and only the 16 byte rows from the first to the last changed one are
+// uploaded, so a camera move that touches the spot light doesn't resend the point lights. T has to be laid out
+// exactly like the glsl block.
+template<typename T>
+class UniformBuffer
+{
+public:
+    T data = T();
+
+    explicit UniformBuffer(UniformBinding binding) : binding(binding) {}
+
+    ~UniformBuffer()
+    {
+        if(UBO)
+            glDeleteBuffers(1, &UBO);
+    }
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // uploads the changed part of data, creating the buffer and binding it to its binding point on first use.
+    // needs the gl context. returns the number of bytes uploaded.
+    size_t Update()
+    {
+        if(!UBO)
+        {
+            glGenBuffers(1, &UBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &data, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+            memcpy(&uploaded, &data, sizeof(T));
+            return count(sizeof(T));
+        }
+        const unsigned char *current = reinterpret_cast<const unsigned char*>(&data);
+        const unsigned char *previous = reinterpret_cast<const unsigned char*>(&uploaded);
+        size_t first = 0, last = sizeof(T);
+        while(first < last && current[first] == previous[first])
+            first++;
+        if(first == last)
+            return count(0);
+        while(last > first && current[last - 1] == previous[last - 1])
+            last--;
+        first &= ~size_t(ROW - 1);
+        last = std::min(sizeof(T), (last + ROW - 1) & ~size_t(ROW - 1));
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, first, last - first, current + first);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        memcpy(reinterpret_cast<unsigned char*>(&uploaded) + first, current + first, last - first);
+        return count(last - first);
+    }
+
+    size_t Uploads() const { return uploads; }
+    size_t Skipped() const { return skipped; }
+    // bytes sent by the last Update
+    size_t LastUploadBytes() const { return lastBytes; }
+
+private:
+    static const size_t ROW = 16;
+
+    UniformBinding binding;
+    unsigned int UBO = 0;
+    // what the buffer currently holds
+    T uploaded = T();
+    size_t uploads = 0;
+    size_t skipped = 0;
+    size_t lastBytes = 0;
+
+    size_t count(size_t bytes)
+    {
+        lastBytes = bytes;
+        if(bytes)
+            uploads++;
+        else
+            skipped++;
+        return bytes;
+    }
+};
+#endif
@@ -0,0 +1,106 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+};
+
+// gpu layout of a mesh's vertices. the cpu side always keeps the full float Vertex, the compact layouts are only
+// what gets uploaded and fetched by the vertex shader.
+enum VertexFormat {
+    VERTEX_FLOAT,               // struct Vertex as is, 56 bytes
+    VERTEX_COMPACT,             // CompactVertex, 24 bytes
+    VERTEX_COMPACT_QUANTIZED    // QuantizedVertex, 20 bytes, positions relative to the mesh AABB
+};
+
+// normal and tangent as signed normalized 10-10-10-2 (GL_INT_2_10_10_10_REV), the tangent's w holds the
+// handedness of the tangent frame, so the bitangent is rebuilt as cross(normal, tangent) * w. uvs are half floats.
+struct CompactVertex {
+    glm::vec3 Position;
+    uint32_t Normal;
+    uint16_t TexCoords[2];
+    uint32_t Tangent;
+};
+
+// CompactVertex with the position stored as 16 bit unorm over the mesh bounds (the 4th value pads to 8 bytes);
+// the vertex shader scales it back with positionScale/positionOffset
+struct QuantizedVertex {
+    uint16_t Position[4];
+    uint32_t Normal;
+    uint16_t TexCoords[2];
+    uint32_t Tangent;
+};
+
+namespace VertexPacking
+{
+    // xyz in [-1, 1] to 10 bits each, w in {-1, 0, 1} to the 2 bit field
+    inline uint32_t PackSnorm1010102(const glm::vec3 &v, float w)
+    {
+        auto field = [](float value, float range, uint32_t mask) {
+            int q = (int)std::floor(std::min(std::max(value, -1.0f), 1.0f) * range + 0.5f);
+            return uint32_t(q) & mask;
+        };
+        return field(v.x, 511.0f, 0x3FF) | (field(v.y, 511.0f, 0x3FF) << 10) | (field(v.z, 511.0f, 0x3FF) << 20) | (field(w, 1.0f, 0x3) << 30);
+    }
+
+    // IEEE half with round to nearest even, overflow to infinity and denormals
+    inline uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, 4);
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t magnitude = bits & 0x7FFFFFFF;
+        if(magnitude >= 0x7F800000)
+            return uint16_t(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+        if(magnitude >= 0x477FF000)
+            return uint16_t(sign | 0x7C00);
+        if(magnitude < 0x38800000)
+        {
+            // denormal half: shift the mantissa (with its implicit 1) into place, rounding
+            if(magnitude < 0x33000000)
+                return uint16_t(sign);
+            uint32_t exponent = magnitude >> 23;
+            uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+            uint32_t shift = 126 - exponent;
+            uint32_t half = mantissa >> shift;
+            uint32_t rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+            if(rest > halfway || (rest == halfway && (half & 1)))
+                half++;
+            return uint16_t(sign | half);
+        }
+        uint32_t half = ((magnitude - 0x38000000) >> 13);
+        uint32_t rest = magnitude & 0x1FFF;
+        if(rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+            half++;
+        return uint16_t(sign | half);
+    }
+
+    // +1 when (tangent, bitangent, normal) is right handed, -1 for mirrored uvs
+    inline float Handedness(const glm::vec3 &normal, const glm::vec3 &tangent, const glm::vec3 &bitangent)
+    {
+        return glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+    }
+
+    inline glm::vec3 SafeNormalize(const glm::vec3 &v)
+    {
+        float length = glm::length(v);
+        return length > 0.0f ? v / length : glm::vec3(0.0f);
+    }
+}
+#endif
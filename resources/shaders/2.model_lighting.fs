@@ -1,64 +1,57 @@
 #version 330 core
+#include "lights.glsl"
+#include "camera.glsl"
+#include "material.glsl"
 out vec4 FragColor;
 
-struct PointLight {
-    vec3 position;
+// features, defined per variant by ShaderVariants (see main.cpp); the defaults build the full shader
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+#ifndef DIRECTION_LIGHT
+#define DIRECTION_LIGHT 1
+#endif
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS LIGHTS_BLOCK_POINT_LIGHTS
+#endif
+// whether the material samples its textures or uses the constant colors single color textures were replaced by
+#ifndef DIFFUSE_MAP
+#define DIFFUSE_MAP 1
+#endif
+#ifndef SPECULAR_MAP
+#define SPECULAR_MAP 1
+#endif
 
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct DirectionLight{
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct SpotLight{
-    vec3 position;
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    float cutOff;
-    float outerCutOff;
-    bool spotSwitch;
-};
-
-struct Material {
-    sampler2D texture_diffuse1;
-    sampler2D texture_specular1;
-
-    float shininess;
-};
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform PointLight pointLight[2];
-uniform DirectionLight directionLight;
-uniform SpotLight spotLight;
 uniform Material material;
 
 uniform samplerCube depthMap1;
 uniform samplerCube depthMap2;
 uniform float far_plane;
-uniform bool shadows;
 
-uniform vec3 viewPosition;
+vec4 DiffuseSample()
+{
+#if DIFFUSE_MAP
+    return texture(material.texture_diffuse1, TexCoords);
+#else
+    return material.diffuseColor;
+#endif
+}
+
+vec4 SpecularSample()
+{
+#if SPECULAR_MAP
+    return texture(material.texture_specular1, TexCoords);
+#else
+    return material.specularColor;
+#endif
+}
 
 float ShadowCalculation(vec3 fragPos, vec3 lightPos, samplerCube depthMap)
 {
@@ -93,15 +86,19 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, s
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
     // combine results
     //shadows
-    float shadow = shadows ? ShadowCalculation(FragPos, light.position, depthMap) : 0.0;
+#if SHADOWS
+    float shadow = ShadowCalculation(FragPos, light.position, depthMap);
+#else
+    float shadow = 0.0;
+#endif
 
     vec3 ambientLight = light.ambient * attenuation;
     vec3 diffuseLight = light.diffuse * diff * attenuation;
     vec3 specularLight = light.specular * spec * attenuation;
 
-    vec3 ambient = ambientLight * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = diffuseLight* vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = specularLight* vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient = ambientLight * vec3(DiffuseSample());
+    vec3 diffuse = diffuseLight* vec3(DiffuseSample());
+    vec3 specular = specularLight* vec3(SpecularSample());
 
     return (ambient + (1.0 - shadow) * (diffuse + specular));
 }
@@ -118,9 +115,9 @@ vec3 CalcDirLight(DirectionLight light, vec3 normal, vec3 viewDir)
     vec3 diffuseLight = light.diffuse * diff;
     vec3 specularLight = light.specular * spec;
 
-    vec3 ambient = ambientLight * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = diffuseLight* vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = specularLight* vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient = ambientLight * vec3(DiffuseSample());
+    vec3 diffuse = diffuseLight* vec3(DiffuseSample());
+    vec3 specular = specularLight* vec3(SpecularSample());
     return (ambient + diffuse + specular);
 }
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
@@ -144,9 +141,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
         vec3 diffuseLight = light.diffuse * diff * attenuation * intensity;
         vec3 specularLight = light.specular * spec * attenuation * intensity;
 
-        vec3 ambient = ambientLight * vec3(texture(material.texture_diffuse1, TexCoords));
-        vec3 diffuse = diffuseLight* vec3(texture(material.texture_diffuse1, TexCoords));
-        vec3 specular = specularLight* vec3(texture(material.texture_specular1, TexCoords));
+        vec3 ambient = ambientLight * vec3(DiffuseSample());
+        vec3 diffuse = diffuseLight* vec3(DiffuseSample());
+        vec3 specular = specularLight* vec3(SpecularSample());
     return (ambient + diffuse + specular);
 }
 
@@ -157,13 +154,19 @@ void main()
 
     vec3 result = vec3(0.0f);
 
+#if POINT_LIGHTS > 0
     result += CalcPointLight(pointLight[0], normal, FragPos, viewDir, depthMap1);
+#endif
+#if POINT_LIGHTS > 1
     result += CalcPointLight(pointLight[1], normal, FragPos, viewDir, depthMap2);
+#endif
+#if DIRECTION_LIGHT
     result += CalcDirLight(directionLight, normal, viewDir);
-
-     if(spotLight.spotSwitch)
-        result += CalcSpotLight(spotLight, normal, FragPos, viewDir);
+#endif
+#if SPOT_LIGHT
+    result += CalcSpotLight(spotLight, normal, FragPos, viewDir);
+#endif
 
 
-    FragColor = vec4(result, texture(material.texture_specular1, TexCoords).a);
+    FragColor = vec4(result, SpecularSample().a);
 }
\ No newline at end of file
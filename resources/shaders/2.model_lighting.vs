@@ -8,12 +8,19 @@ out vec3 Normal;
 out vec3 FragPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// per frame camera, shared with the other programs
+#include "camera.glsl"
+
+// meshes with quantized positions (VERTEX_COMPACT_QUANTIZED) store them as 0..1 over their bounds
+uniform bool quantizedPosition;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = quantizedPosition ? positionOffset + aPos * positionScale : aPos;
+    FragPos = vec3(model * vec4(position, 1.0));
     Normal = aNormal;
     TexCoords = aTexCoords;    
     gl_Position = projection * view * vec4(FragPos, 1.0);
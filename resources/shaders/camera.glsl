@@ -0,0 +1,12 @@
+// per frame camera, shared by every program that projects with the scene camera (CameraBlock in c++)
+#ifndef CAMERA_GLSL
+#define CAMERA_GLSL
+#include "std140.glsl"
+
+STD140_BLOCK(Camera) {
+    STD140_MAT4(projection)
+    STD140_MAT4(view)
+    STD140_VEC3(viewPosition)
+};
+
+#endif
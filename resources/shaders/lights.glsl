@@ -0,0 +1,45 @@
+// the scene lights, one Lights block per frame (LightsBlock and the *LightBlock structs in c++)
+#ifndef LIGHTS_GLSL
+#define LIGHTS_GLSL
+#include "std140.glsl"
+
+#define LIGHTS_BLOCK_POINT_LIGHTS 2
+
+STD140_STRUCT(PointLight) {
+    STD140_VEC3(position)
+    STD140_FLOAT(constant)
+    STD140_VEC3(ambient)
+    STD140_FLOAT(linear)
+    STD140_VEC3(diffuse)
+    STD140_FLOAT(quadratic)
+    STD140_VEC3(specular)
+};
+
+STD140_STRUCT(DirectionLight) {
+    STD140_VEC3(direction)
+    STD140_VEC3(ambient)
+    STD140_VEC3(diffuse)
+    STD140_VEC3(specular)
+};
+
+STD140_STRUCT(SpotLight) {
+    STD140_VEC3(position)
+    STD140_FLOAT(constant)
+    STD140_VEC3(direction)
+    STD140_FLOAT(linear)
+    STD140_VEC3(ambient)
+    STD140_FLOAT(quadratic)
+    STD140_VEC3(diffuse)
+    STD140_FLOAT(cutOff)        // cosines
+    STD140_VEC3(specular)
+    STD140_FLOAT(outerCutOff)
+    STD140_BOOL(spotSwitch)     // kept for the block layout, the SPOT_LIGHT shader feature decides
+};
+
+STD140_BLOCK(Lights) {
+    STD140_ARRAY(PointLight, pointLight, LIGHTS_BLOCK_POINT_LIGHTS)
+    STD140_MEMBER(DirectionLight, directionLight)
+    STD140_MEMBER(SpotLight, spotLight)
+};
+
+#endif
@@ -0,0 +1,17 @@
+// the material Material::Bind fills in. the samplers are pointed at their TextureSlot units once, by
+// Shader::materialUniforms; binding a material only binds its textures and sets the constant colors.
+#ifndef MATERIAL_GLSL
+#define MATERIAL_GLSL
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+
+    // single color textures are replaced by these constants at import
+    vec4 diffuseColor;
+    vec4 specularColor;
+
+    float shininess;
+};
+
+#endif
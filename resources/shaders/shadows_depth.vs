@@ -3,7 +3,13 @@ layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
 
+// meshes with quantized positions (VERTEX_COMPACT_QUANTIZED) store them as 0..1 over their bounds
+uniform bool quantizedPosition;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    vec3 position = quantizedPosition ? positionOffset + aPos * positionScale : aPos;
+    gl_Position = model * vec4(position, 1.0);
 }
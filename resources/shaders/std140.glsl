@@ -0,0 +1,33 @@
+// declarations shared between the shaders and c++. files written with these macros are included by the shaders
+// (through Shader's #include) and by uniform_blocks.h, which gets structs laid out like the std140 blocks: every
+// vec3, vec4, mat4 and struct is aligned to 16 bytes there, so a vec3 followed by a float shares its 16 bytes and
+// the offsets match std140 without hand written padding. the c++ structs are named with a Block suffix.
+// only the member types below are supported; std140 gives float and int arrays a 16 byte stride, c++ doesn't.
+#ifndef STD140_GLSL
+#define STD140_GLSL
+
+#ifdef __cplusplus
+#define STD140_STRUCT(name) struct alignas(16) name##Block
+#define STD140_BLOCK(name) struct alignas(16) name##Block
+#define STD140_FLOAT(name) float name;
+#define STD140_INT(name) int name;
+#define STD140_BOOL(name) int name;
+#define STD140_VEC3(name) alignas(16) glm::vec3 name;
+#define STD140_VEC4(name) alignas(16) glm::vec4 name;
+#define STD140_MAT4(name) alignas(16) glm::mat4 name;
+#define STD140_MEMBER(type, name) type##Block name;
+#define STD140_ARRAY(type, name, count) type##Block name[count];
+#else
+#define STD140_STRUCT(name) struct name
+#define STD140_BLOCK(name) layout (std140) uniform name
+#define STD140_FLOAT(name) float name;
+#define STD140_INT(name) int name;
+#define STD140_BOOL(name) bool name;
+#define STD140_VEC3(name) vec3 name;
+#define STD140_VEC4(name) vec4 name;
+#define STD140_MAT4(name) mat4 name;
+#define STD140_MEMBER(type, name) type name;
+#define STD140_ARRAY(type, name, count) type name[count];
+#endif
+
+#endif
@@ -12,9 +12,18 @@
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
+#include <learnopengl/gl_state.h>
 #include <learnopengl/model.h>
+#include <learnopengl/model_loader.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/scene.h>
+#include <learnopengl/shader_variants.h>
+#include <learnopengl/trace.h>
+#include <learnopengl/uniform_blocks.h>
+#include <learnopengl/uniform_buffer.h>
 
 #include <iostream>
+#include <memory>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 
@@ -33,6 +42,24 @@ unsigned int loadTexture(const char *path);
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// gl upload time spent per frame on models that are still streaming in
+const double MODEL_UPLOAD_BUDGET_MS = 4.0;
+// point lights of the lighting shader, each with its shadow cubemap
+const unsigned int POINT_LIGHTS = LIGHTS_BLOCK_POINT_LIGHTS;
+// uniform prefix of the material struct in the lighting shader
+const std::string MATERIAL_PREFIX = "material.";
+// texture unit of the first shadow cubemap, right after the units of the material textures
+const unsigned int DEPTH_MAP_UNIT = MATERIAL_TEXTURE_UNITS;
+// compile time features of the lighting shader (2.model_lighting.fs), packed into its ShaderVariants key
+enum LightingFeature {
+    LIGHTING_SHADOWS = 1 << 0,
+    LIGHTING_SPOT_LIGHT = 1 << 1,
+    LIGHTING_DIRECTION_LIGHT = 1 << 2,
+    LIGHTING_DIFFUSE_MAP = 1 << 3,
+    LIGHTING_SPECULAR_MAP = 1 << 4
+};
+// number of point lights evaluated, 0..POINT_LIGHTS, in two bits from here
+const unsigned int LIGHTING_POINT_LIGHTS_SHIFT = 5;
 
 // camera
 
@@ -47,27 +74,38 @@ float lastFrame = 0.0f;
 //spotLight switch
 bool spotSwitch = false;
 
-struct DirectionLight{
-    glm::vec3 direction;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-};
-
 struct ProgramState {
     bool ImGuiEnabled = false;
     Camera camera;
     bool CameraMouseMovementUpdateEnabled = true;
-    DirectionLight directionLight;
+    // edited in the gui, declared with the Lights block in resources/shaders/lights.glsl
+    DirectionLightBlock directionLight = DirectionLightBlock();
     bool shadows = true;
-    Model *AE86, *lamps, *dumpster;
+    bool sortByMaterial = true;
+    // largest on screen error, in pixels, a level of detail may have; shadow maps tolerate coarser meshes
+    float lodPixelError = 1.0f;
+    float shadowLodPixelError = 4.0f;
+    Scene scene;
+    // one model per scene asset, same order. models release their gl textures, so they go away with the program
+    // state, before the context does
+    std::vector<std::unique_ptr<Model>> models;
+    // point lights the scene defines, the rest of the POINT_LIGHTS slots are black and not evaluated
+    unsigned int pointLightCount = POINT_LIGHTS;
+    // the car instance is placed from here, on top of its transform in the scene file
+    int carInstance = -1;
+    glm::mat4 carTransform = glm::mat4(1.0f);
 
     glm::vec3 ae86pos = glm::vec3(0.0f, 0.11f, 0.0f);
     float ae86angle = 205.0f;
+    // the Camera and Lights uniform blocks, filled every frame and uploaded when they changed
+    UniformBuffer<CameraBlock> cameraBuffer;
+    UniformBuffer<LightsBlock> lightsBuffer;
+    // the draws of a frame: the shadow queue is filled once per light, the scene queue holds the camera's passes
+    RenderQueue shadowQueue;
+    RenderQueue sceneQueue;
 
     ProgramState()
-            : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
+            : camera(glm::vec3(0.0f, 0.0f, 3.0f)), cameraBuffer(CAMERA_BINDING), lightsBuffer(LIGHTS_BINDING) {}
 
     void SaveToFile(std::string filename);
 
@@ -107,9 +145,43 @@ ProgramState *programState;
 
 void DrawImGui(ProgramState *programState);
 
-void renderScene(Shader &ourShader);
+// per pass settings of the lighting shader variants
+struct LightingPass {
+    unsigned int features = 0;      // LightingFeature bits, the material ones are added per mesh
+    float farPlane = 25.0f;
+};
+
+void enqueueScene(RenderQueue &queue, RenderPass pass, const std::function<Shader&(const Mesh&)> &select);
+
+void setupLighting(Shader &shader, const LightingPass &pass);
+
+// what drawSkybox needs, handed to the render queue as the context of its callback
+struct Skybox {
+    Shader *shader;
+    unsigned int vao;
+    unsigned int cubemap;
+};
+
+void drawSkybox(void *context);
+
+unsigned int lightingFeatures();
+
+int main(int argc, char **argv) {
+    // startup tracing: --trace <file> or RG_TRACE=<file> writes a chrome://tracing json once the models are loaded
+    std::string tracePath;
+    for (int i = 1; i + 1 < argc; i++)
+        if (std::string(argv[i]) == "--trace")
+            tracePath = argv[i + 1];
+    Trace::Start(tracePath);
+    Trace::SetThreadName("main");
+    // the phases of main, each recorded from the end of the previous one
+    uint64_t phaseStart = Trace::Now();
+    auto endPhase = [&phaseStart](const char *name) {
+        uint64_t now = Trace::Now();
+        Trace::Record(name, std::string(), phaseStart, now);
+        phaseStart = now;
+    };
 
-int main() {
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -136,6 +208,7 @@ int main() {
     glfwSetKeyCallback(window, key_callback);
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    endPhase("glfw init");
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -143,6 +216,11 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // which block compressed formats the texture loaders may use
+    TextureCompression::DetectSupport();
+    // linked shader programs are cached on disk when the driver can hand out their binaries
+    ProgramCache::Init((GLADloadproc) glfwGetProcAddress);
+    endPhase("glad init");
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
@@ -162,51 +240,84 @@ int main() {
 
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
+    endPhase("imgui init");
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    GLState::Enable(GL_DEPTH_TEST);
+
+    // load the scene
+    // --------------
+    Scene &scene = programState->scene;
+    if (!scene.Load("resources/scenes/parking.scene", POINT_LIGHTS)) {
+        std::cout << "Failed to load the scene" << std::endl;
+        return -1;
+    }
+    // lights the scene leaves out stay black, the lighting shader skips them and they cast no shadows
+    programState->pointLightCount = (unsigned int)std::min<size_t>(scene.pointLights.size(), POINT_LIGHTS);
+    programState->carInstance = scene.FindInstance("car");
+    if (programState->carInstance >= 0)
+        programState->carTransform = scene.instances[programState->carInstance].transform;
+
+    DirectionLightBlock& directionLight = programState->directionLight;
+
+    directionLight.direction = scene.directionLight.direction;
+    directionLight.ambient = scene.directionLight.ambient;
+    directionLight.diffuse = scene.directionLight.diffuse;
+    directionLight.specular = scene.directionLight.specular;
+    endPhase("scene parse");
 
     // build and compile shaders
     // -------------------------
     stbi_set_flip_vertically_on_load(false);
-    Shader ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
+    double shaderStart = glfwGetTime();
+    ShaderVariants lighting("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs", "", {
+            {"SHADOWS", 0, 1}, {"SPOT_LIGHT", 1, 1}, {"DIRECTION_LIGHT", 2, 1}, {"DIFFUSE_MAP", 3, 1}, {"SPECULAR_MAP", 4, 1},
+            {"POINT_LIGHTS", LIGHTING_POINT_LIGHTS_SHIFT, 2}});
+    // what the first frames draw: the current settings with the spotlight either way, for every kind of material
+    {
+        const unsigned int settings = lightingFeatures() & ~LIGHTING_SPOT_LIGHT, spot = LIGHTING_SPOT_LIGHT;
+        const unsigned int diffuse = LIGHTING_DIFFUSE_MAP, specular = LIGHTING_SPECULAR_MAP;
+        lighting.Precompile({settings, settings | diffuse, settings | specular, settings | diffuse | specular,
+                             settings | spot, settings | spot | diffuse, settings | spot | specular,
+                             settings | spot | diffuse | specular});
+    }
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
     Shader depthShader("resources/shaders/shadows_depth.vs", "resources/shaders/shadows_depth.fs", "resources/shaders/shadows_depth.gs");
-
-    // load models
-    // -----------
-
-
-    DirectionLight& directionLight = programState->directionLight;
-
-    directionLight.direction = glm::vec3(0.0f, -1.0f, 1.0f);
-    directionLight.ambient = glm::vec3(0.1, 0.1, 0.1);
-    directionLight.diffuse = glm::vec3(0.3f, 0.3f, 0.12f);
-    directionLight.specular = glm::vec3(0.1, 0.1, 0.1);
-
+    ProgramCache::Stats programStats = ProgramCache::GetStats();
+    std::cout << "Shaders ready in " << (glfwGetTime() - shaderStart) * 1000.0 << " ms (" << lighting.Compiled()
+              << " lighting variants), " << programStats.hits << " from the program cache";
+    if (!ProgramCache::IsAvailable())
+        std::cout << " (unavailable)";
+    else if (programStats.rejected > 0)
+        std::cout << ", " << programStats.rejected << " rejected by the driver";
+    std::cout << std::endl;
+    endPhase("shaders");
 
     //enabling blending
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_DEPTH_TEST);
-
-    Model AE86("resources/objects/jdm/AE86Trueno.obj");
-    AE86.SetShaderTextureNamePrefix("material.");
-    programState->AE86 = &AE86;
-
-    Model lamps("resources/objects/lamps/lamps.obj");
-    lamps.SetShaderTextureNamePrefix("material.");
-    programState->lamps = &lamps;
-
-    Model dumpster("resources/objects/dumpster/dumpster_obj.obj");
-    dumpster.SetShaderTextureNamePrefix("material.");
-    programState->dumpster = &dumpster;
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Enable(GL_DEPTH_TEST);
+
+    // imports and texture decodes run on a worker pool while the render loop is already running. the models draw
+    // a placeholder box until the loader has uploaded them, a few milliseconds of upload work per frame.
+    ModelLoader loader;
+    bool modelsLoaded = false;
+
+    // every asset is queued up front, whatever number of instances use it
+    for (const SceneAsset &asset : scene.assets) {
+        programState->models.emplace_back(new Model);
+        Model &model = *programState->models.back();
+        model.SetShaderTextureNamePrefix(MATERIAL_PREFIX);
+        model.vertexFormat = asset.format;
+        loader.Load(model, asset.path);
+    }
+    endPhase("queue models");
 
     //enabling faceculling
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
+    GLState::Enable(GL_CULL_FACE);
+    GLState::CullFace(GL_BACK);
+    GLState::FrontFace(GL_CCW);
 
 
     float skyboxVertices[] = {
@@ -258,7 +369,7 @@ int main() {
     unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
+    GLState::BindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
@@ -322,64 +433,42 @@ int main() {
                     FileSystem::getPath("resources/textures/cloudskybox/back.jpg")
             };
 
-    stbi_set_flip_vertically_on_load(false);
+    // the flip flag stays off from here on: model textures are still being decoded on the loader threads
     unsigned int cubemapTexture = loadCubemap(faces);
-    stbi_set_flip_vertically_on_load(true);
+    endPhase("cubemap load");
 
     // configure depth map FBO
     // -----------------------
     const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-    unsigned int depthMap1FBO;
-    glGenFramebuffers(1, &depthMap1FBO);
-    // create depth cubemap texture
-    unsigned int depthCubemap1;
-    glGenTextures(1, &depthCubemap1);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap1);
-    for (unsigned int i = 0; i < 6; ++i)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    // attach depth texture as FBO's depth buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMap1FBO);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap1, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    unsigned int depthMap2FBO;
-    glGenFramebuffers(1, &depthMap2FBO);
-    // create depth cubemap texture
-    unsigned int depthCubemap2;
-    glGenTextures(1, &depthCubemap2);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap2);
-    for (unsigned int i = 0; i < 6; ++i)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    // attach depth texture as FBO's depth buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMap2FBO);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap2, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // one per point light slot, the lighting shaders sample depthMap1 and depthMap2 whether the light exists or not
+    unsigned int depthMapFBO[POINT_LIGHTS];
+    unsigned int depthCubemap[POINT_LIGHTS];
+    glGenFramebuffers(POINT_LIGHTS, depthMapFBO);
+    glGenTextures(POINT_LIGHTS, depthCubemap);
+    for (unsigned int light = 0; light < POINT_LIGHTS; light++) {
+        // create depth cubemap texture
+        GLState::BindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap[light]);
+        for (unsigned int i = 0; i < 6; ++i)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        // attach depth texture as FBO's depth buffer
+        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO[light]);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap[light], 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    endPhase("shadow fbos");
 
 
 
 
-    // shader configuration
+    // shader configuration, the lighting variants are set up by setupLighting whenever a draw switches to one
     // --------------------
-    ourShader.use();
-    ourShader.setInt("material.texture_diffuse1", 0);
-    ourShader.setInt("depthMap1", 1);
-    ourShader.setInt("depthMap2", 2);
-
-
     skyboxShader.use();
     skyboxShader.setInt("texture1", 0);
 
@@ -397,7 +486,7 @@ int main() {
     unsigned int VBO, VAO;
     glGenBuffers(1, &VBO);
     glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    GLState::BindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(roadVertices), roadVertices, GL_STATIC_DRAW);
@@ -414,16 +503,37 @@ int main() {
 
 
     unsigned int roadTex = loadTexture(FileSystem::getPath("resources/textures/parking.jpg").c_str());
+    // diffuse and specular both sample the road texture
+    Material roadMaterial;
+    roadMaterial.textures[TEXTURE_DIFFUSE] = roadTex;
+    roadMaterial.textures[TEXTURE_SPECULAR] = roadTex;
+    endPhase("road setup");
 
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 
-    glm::vec3 lightPos[2] = {glm::vec3 (-1.74f, 1.48f, -0.12f), glm::vec3(1.74f, 1.48f, 0.12f)};
+    glm::vec3 lightPos[POINT_LIGHTS] = {};
+    for (unsigned int i = 0; i < programState->pointLightCount; i++)
+        lightPos[i] = scene.pointLights[i].position;
+
+    Skybox skybox = {&skyboxShader, skyboxVAO, cubemapTexture};
+    RenderQueue &shadowQueue = programState->shadowQueue;
+    RenderQueue &sceneQueue = programState->sceneQueue;
+    // the shadow passes draw every mesh with the depth program
+    std::function<Shader&(const Mesh&)> depthProgram = [&depthShader](const Mesh &) -> Shader& { return depthShader; };
+    // its per pass uniforms, resolved once instead of by name every frame
+    UniformHandle<glm::mat4> shadowMatrices[6];
+    for (unsigned int i = 0; i < 6; ++i)
+        shadowMatrices[i] = depthShader.uniform<glm::mat4>("shadowMatrices[" + std::to_string(i) + "]");
+    UniformHandle<float> depthFarPlane = depthShader.uniform<float>("far_plane");
+    UniformHandle<glm::vec3> depthLightPos = depthShader.uniform<glm::vec3>("lightPos");
 
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window)) {
+        // frames drawn while the models stream in are part of the startup trace
+        TraceZone frameZone("frame");
         // per-frame time logic
         // --------------------
         float currentFrame = glfwGetTime();
@@ -433,6 +543,42 @@ int main() {
         // input
         // -----
         processInput(window);
+        Model::ResetDrawStats();
+        RenderQueue::ResetStats();
+        GLState::ResetStats();
+        Shader::ResetUniformStats();
+        if (programState->carInstance >= 0) {
+            glm::mat4 placement = glm::translate(glm::mat4(1.0f), programState->ae86pos);
+            placement = glm::rotate(placement, glm::radians(programState->ae86angle), glm::vec3(0.0f, 1.0f, 0.0f));
+            scene.instances[programState->carInstance].transform = placement * programState->carTransform;
+        }
+
+        // stream in models
+        // ----------------
+        if (!modelsLoaded && loader.Update(MODEL_UPLOAD_BUDGET_MS)) {
+            modelsLoaded = true;
+            const ModelLoader::Stats &stats = loader.GetStats();
+            std::cout << "Loaded " << stats.modelsLoaded << " models and " << stats.texturesDecoded << " textures on "
+                      << stats.threads << " threads in " << glfwGetTime() << " s, peak decoded image memory "
+                      << stats.peakDecodedBytes / (1024 * 1024) << " MB" << std::endl;
+            TextureCache::Stats textureStats = TextureCache::Instance().GetStats();
+            std::cout << "Texture cache: " << textureStats.textures << " textures, "
+                      << textureStats.residentBytes / 1024 << " KB resident, "
+                      << textureStats.pathHits << " path hits, " << textureStats.contentHits << " content hits, "
+                      << textureStats.savedBytes / 1024 << " KB saved by deduplication" << std::endl;
+            // every draw of a mesh, shadow cubemap passes included, fetches from these buffers
+            for (size_t i = 0; i < scene.assets.size(); i++) {
+                Model::VertexStats vertexStats = programState->models[i]->GetVertexStats();
+                std::cout << "Vertices of " << scene.assets[i].name << ": " << vertexStats.vertices << ", "
+                          << vertexStats.bytes / 1024 << " KB on the gpu (" << vertexStats.floatBytes / 1024
+                          << " KB as floats, " << (vertexStats.bytes ? double(vertexStats.floatBytes) / vertexStats.bytes : 0.0)
+                          << "x less to fetch per draw), indices " << vertexStats.indexBytes / 1024 << " KB ("
+                          << vertexStats.indexBytes32 / 1024 << " KB as 32 bit), cpu copy " << vertexStats.cpuBytes / 1024
+                          << " KB kept, " << vertexStats.cpuBytesReleased / 1024 << " KB released" << std::endl;
+            }
+            if (Trace::Finish())
+                std::cout << "Startup trace written to " << Trace::Path() << std::endl;
+        }
 
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -442,136 +588,115 @@ int main() {
         float near_plane = 1.0f;
         float far_plane  = 25.0f;
         glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT, near_plane, far_plane);
-        std::vector<glm::mat4> shadowTransforms1;
-        shadowTransforms1.push_back(shadowProj * glm::lookAt(lightPos[0], lightPos[0] + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-        shadowTransforms1.push_back(shadowProj * glm::lookAt(lightPos[0], lightPos[0] + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-        shadowTransforms1.push_back(shadowProj * glm::lookAt(lightPos[0], lightPos[0] + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)));
-        shadowTransforms1.push_back(shadowProj * glm::lookAt(lightPos[0], lightPos[0] + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)));
-        shadowTransforms1.push_back(shadowProj * glm::lookAt(lightPos[0], lightPos[0] + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-        shadowTransforms1.push_back(shadowProj * glm::lookAt(lightPos[0], lightPos[0] + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-
-        std::vector<glm::mat4> shadowTransforms2;
-        shadowTransforms2.push_back(shadowProj * glm::lookAt(lightPos[1], lightPos[1] + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-        shadowTransforms2.push_back(shadowProj * glm::lookAt(lightPos[1], lightPos[1] + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-        shadowTransforms2.push_back(shadowProj * glm::lookAt(lightPos[1], lightPos[1] + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)));
-        shadowTransforms2.push_back(shadowProj * glm::lookAt(lightPos[1], lightPos[1] + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)));
-        shadowTransforms2.push_back(shadowProj * glm::lookAt(lightPos[1], lightPos[1] + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-        shadowTransforms2.push_back(shadowProj * glm::lookAt(lightPos[1], lightPos[1] + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-
-        // render scene to depth cubemap1
-        // --------------------------------
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMap1FBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        depthShader.use();
-        for (unsigned int i = 0; i < 6; ++i)
-            depthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms1[i]);
-        depthShader.setFloat("far_plane", far_plane);
-        depthShader.setVec3("lightPos", lightPos[0]);
-        renderScene(depthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // render scene to depth cubemap2
-        // --------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMap2FBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        depthShader.use();
-        for (unsigned int i = 0; i < 6; ++i)
-            depthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms2[i]);
-        depthShader.setFloat("far_plane", far_plane);
-        depthShader.setVec3("lightPos", lightPos[1]);
-        renderScene(depthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // render scene to the depth cubemap of every point light the scene has
+        // ---------------------------------------------------------------------
+        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+        for (unsigned int light = 0; light < programState->pointLightCount; light++) {
+            const glm::vec3 &position = lightPos[light];
+            glm::mat4 shadowTransforms[6] = {
+                shadowProj * glm::lookAt(position, position + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                shadowProj * glm::lookAt(position, position + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                shadowProj * glm::lookAt(position, position + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+                shadowProj * glm::lookAt(position, position + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+                shadowProj * glm::lookAt(position, position + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                shadowProj * glm::lookAt(position, position + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+            };
+            glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO[light]);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            depthShader.use();
+            for (unsigned int i = 0; i < 6; ++i)
+                depthShader.set(shadowMatrices[i], shadowTransforms[i]);
+            depthShader.set(depthFarPlane, far_plane);
+            depthShader.set(depthLightPos, position);
+            Model::SetLodView(position, glm::radians(90.0f), (float)SHADOW_HEIGHT, programState->shadowLodPixelError);
+            shadowQueue.Begin(position, far_plane);
+            enqueueScene(shadowQueue, RENDER_PASS_SHADOW, depthProgram);
+            shadowQueue.Sort();
+            shadowQueue.Submit(RENDER_PASS_SHADOW);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
 
 
         //rendering scene with shadows
         glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        ourShader.use();
-
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),(float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setInt("shadows", programState->shadows);
-        ourShader.setFloat("far_plane", far_plane);
-
-        //point light 1
-        ourShader.setVec3("pointLight[0].position", lightPos[0]);
-        ourShader.setVec3("pointLight[0].ambient", glm::vec3(0.05f, 0.05f, 0.05f));
-        ourShader.setVec3("pointLight[0].diffuse", glm::vec3(0.4f, 0.4f, 0.4f));
-        ourShader.setVec3("pointLight[0].specular", glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setFloat("pointLight[0].constant", 1.0f);
-        ourShader.setFloat("pointLight[0].linear", 0.09f);
-        ourShader.setFloat("pointLight[0].quadratic", 0.032f);
-        //point light 2
-        ourShader.setVec3("pointLight[1].position", lightPos[1]);
-        ourShader.setVec3("pointLight[1].ambient", glm::vec3(0.05f, 0.05f, 0.05f));
-        ourShader.setVec3("pointLight[1].diffuse", glm::vec3(0.4f, 0.4f, 0.4f));
-        ourShader.setVec3("pointLight[1].specular", glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setFloat("pointLight[1].constant", 1.0f);
-        ourShader.setFloat("pointLight[1].linear", 0.09f);
-        ourShader.setFloat("pointLight[1].quadratic", 0.032f);
+        LightingPass pass;
+        pass.features = lightingFeatures();
+        pass.farPlane = far_plane;
+
+        // view/projection transformations, shared with the skybox through the Camera block
+        CameraBlock &camera = programState->cameraBuffer.data;
+        float camera_far = 100.0f;
+        camera.projection = glm::perspective(glm::radians(programState->camera.Zoom),(float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, camera_far);
+        camera.view = programState->camera.GetViewMatrix();
+        camera.viewPosition = programState->camera.Position;
+        programState->cameraBuffer.Update();
+
+        // lights, one Lights block upload replaces the per light uniforms
+        LightsBlock &lights = programState->lightsBuffer.data;
+        for (unsigned int i = 0; i < programState->pointLightCount; i++) {
+            const ScenePointLight &light = scene.pointLights[i];
+            lights.pointLight[i].position = lightPos[i];
+            lights.pointLight[i].ambient = light.ambient;
+            lights.pointLight[i].diffuse = light.diffuse;
+            lights.pointLight[i].specular = light.specular;
+            lights.pointLight[i].constant = light.constant;
+            lights.pointLight[i].linear = light.linear;
+            lights.pointLight[i].quadratic = light.quadratic;
+        }
         //spotlight
-        ourShader.setVec3("spotLight.ambient",  0.1f, 0.1f, 0.1f);
-        ourShader.setVec3("spotLight.diffuse",  0.5f, 0.5f, 0.5f);
-        ourShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-        ourShader.setVec3("spotLight.direction", programState->camera.Front);
-        ourShader.setVec3("spotLight.position", programState->camera.Position);
-        ourShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-        ourShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(17.5f)));
-        ourShader.setFloat("spotLight.constant",  1.0f);
-        ourShader.setFloat("spotLight.linear",    0.09f);
-        ourShader.setFloat("spotLight.quadratic", 0.032f);
-        ourShader.setBool("spotLight.spotSwitch", spotSwitch);
+        lights.spotLight.ambient = scene.spotLight.ambient;
+        lights.spotLight.diffuse = scene.spotLight.diffuse;
+        lights.spotLight.specular = scene.spotLight.specular;
+        lights.spotLight.direction = programState->camera.Front;
+        lights.spotLight.position = programState->camera.Position;
+        lights.spotLight.cutOff = glm::cos(glm::radians(scene.spotLight.cutOff));
+        lights.spotLight.outerCutOff = glm::cos(glm::radians(scene.spotLight.outerCutOff));
+        lights.spotLight.constant = scene.spotLight.constant;
+        lights.spotLight.linear = scene.spotLight.linear;
+        lights.spotLight.quadratic = scene.spotLight.quadratic;
+        lights.spotLight.spotSwitch = spotSwitch;
         //direction light
-        ourShader.setVec3("directionLight.ambient",  programState->directionLight.ambient);
-        ourShader.setVec3("directionLight.diffuse",  programState->directionLight.diffuse);
-        ourShader.setVec3("directionLight.specular", programState->directionLight.specular);
-        ourShader.setVec3("directionLight.direction", programState->directionLight.direction);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, roadTex);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap2);
-
-        renderScene(ourShader);
+        lights.directionLight = programState->directionLight;
+        programState->lightsBuffer.Update();
+
+        // no other cubemap goes to these units, past the first frame both binds are skipped
+        for (unsigned int light = 0; light < POINT_LIGHTS; light++)
+            GLState::BindTexture(DEPTH_MAP_UNIT + light, GL_TEXTURE_CUBE_MAP, depthCubemap[light]);
+
+        // everything the camera sees goes through the scene queue: the instances and the road grouped by program and
+        // material and drawn front to back, then the skybox behind them, then the gui
+        Model::SetLodView(programState->camera.Position, glm::radians(programState->camera.Zoom), (float)SCR_HEIGHT,
+                          programState->lodPixelError);
+        sceneQueue.Begin(programState->camera.Position, camera_far);
+        std::function<Shader&(const Mesh&)> lightingProgram = [&lighting, &pass](const Mesh &mesh) -> Shader& {
+            unsigned int features = pass.features;
+            if (mesh.SamplesDiffuseMap())
+                features |= LIGHTING_DIFFUSE_MAP;
+            if (mesh.SamplesSpecularMap())
+                features |= LIGHTING_SPECULAR_MAP;
+            return lighting.Get(features);
+        };
+        enqueueScene(sceneQueue, RENDER_PASS_OPAQUE, lightingProgram);
 
         //rendering terrain
-        ourShader.use();
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::scale(model, glm::vec3(3.0f));
         model = glm::rotate(model, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setMat4("model", model);
-        ourShader.setFloat("material.shininess", 32.0f);
-        glBindVertexArray(VAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, roadTex);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-
-        //skybox rendering
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
+        sceneQueue.AddArrays(RENDER_PASS_OPAQUE, lighting.Get(pass.features | LIGHTING_DIFFUSE_MAP | LIGHTING_SPECULAR_MAP),
+                             VAO, 6, model, &roadMaterial, &MATERIAL_PREFIX, 32.0f);
+
+        //skybox rendering, after everything else so only the pixels nothing covers are shaded
+        sceneQueue.AddCallback(RENDER_PASS_OPAQUE, 1, drawSkybox, &skybox);
 
         if (programState->ImGuiEnabled)
-            DrawImGui(programState);
+            sceneQueue.AddCallback(RENDER_PASS_UI, 0, [](void *state) { DrawImGui((ProgramState*)state); }, programState);
+
+        sceneQueue.Sort();
+        sceneQueue.Submit(RENDER_PASS_OPAQUE, [&pass](Shader &shader) { setupLighting(shader, pass); });
+        sceneQueue.Submit(RENDER_PASS_TRANSPARENT, [&pass](Shader &shader) { setupLighting(shader, pass); });
+        sceneQueue.Submit(RENDER_PASS_UI);
 
 
 
@@ -581,6 +706,9 @@ int main() {
         glfwPollEvents();
     }
 
+    // closed before the models finished loading
+    if (Trace::Finish())
+        std::cout << "Startup trace written to " << Trace::Path() << std::endl;
     programState->SaveToFile("resources/program_state.txt");
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
@@ -591,48 +719,46 @@ int main() {
     glfwTerminate();
     return 0;
 }
-void renderScene(Shader &ourShader){
-    //car
-    glm::mat4 model2 = glm::mat4(1.0f);
-    model2 = glm::translate(model2, programState->ae86pos);
-    model2 = glm::rotate(model2, glm::radians(programState->ae86angle), glm::vec3(0.0f, 1.0f, 0.0f));
-    model2 = glm::scale(model2, glm::vec3(0.2f));
-    ourShader.setMat4("model", model2);
-    ourShader.setFloat("material.shininess", 128.0f);
-
-    programState->AE86->Draw(ourShader);
-
-    //lamps
-
-    glm::mat4 model3 = glm::mat4(1.0f);
-    model3 = glm::translate(model3, glm::vec3(0.0f, 0.11f, 0.0f));
-    model3 = glm::scale(model3, glm::vec3(0.2f));
-    ourShader.setMat4("model", model3);
-
-
-    programState->lamps->Draw(ourShader);
-
-    glm::mat4 model4 = glm::mat4(1.0f);
-    model4 = glm::translate(model4, glm::vec3(2.6f, 0.0f, 0.9f));
-    model4 = glm::rotate(model4, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model4 = glm::scale(model4, glm::vec3(0.25f));
-    ourShader.setMat4("model", model4);
-
-    programState->dumpster->Draw(ourShader);
-
-    model4 = glm::translate(model4, glm::vec3(-2.1f, 0.0f, 0.0f));
-    model4 = glm::rotate(model4, glm::radians(-10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    ourShader.setMat4("model", model4);
-
-    programState->dumpster->Draw(ourShader);
+// lighting variant for the current settings, without the material bits
+unsigned int lightingFeatures() {
+    unsigned int features = programState->pointLightCount << LIGHTING_POINT_LIGHTS_SHIFT;
+    if (programState->shadows)
+        features |= LIGHTING_SHADOWS;
+    if (spotSwitch)
+        features |= LIGHTING_SPOT_LIGHT;
+    const DirectionLightBlock &light = programState->directionLight;
+    if (light.ambient != glm::vec3(0.0f) || light.diffuse != glm::vec3(0.0f) || light.specular != glm::vec3(0.0f))
+        features |= LIGHTING_DIRECTION_LIGHT;
+    return features;
+}
 
-    model4 = glm::rotate(model4, glm::radians(10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model4 = glm::translate(model4, glm::vec3(-4.5f, 0.0f, 0.0f));
-    model4 = glm::rotate(model4, glm::radians(10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    ourShader.setMat4("model", model4);
+// everything a lighting variant needs before a draw, apart from what the render queue sets per item (model matrix
+// and shininess). repeated on every program switch, the uniforms a variant already holds are not uploaded again.
+void setupLighting(Shader &shader, const LightingPass &pass) {
+    shader.setInt("depthMap1", DEPTH_MAP_UNIT);
+    shader.setInt("depthMap2", DEPTH_MAP_UNIT + 1);
+    shader.setFloat("far_plane", pass.farPlane);
+}
 
-    programState->dumpster->Draw(ourShader);
+// adds every instance of the scene's flat instance table to a pass of queue, each mesh drawn with the program
+// select picks for it
+void enqueueScene(RenderQueue &queue, RenderPass pass, const std::function<Shader&(const Mesh&)> &select) {
+    const Scene &scene = programState->scene;
+    for (const SceneInstance &instance : scene.instances)
+        programState->models[instance.asset]->Enqueue(queue, pass, instance.transform,
+                                                      scene.materials[instance.material].shininess, select);
+}
 
+void drawSkybox(void *context) {
+    const Skybox &skybox = *(const Skybox*)context;
+    GLState::DepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+    // view and projection come from the Camera block, the shader drops the translation itself
+    skybox.shader->use();
+    // skybox cube
+    GLState::BindVertexArray(skybox.vao);
+    GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, skybox.cubemap);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    GLState::DepthFunc(GL_LESS); // set depth function back to default
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
@@ -716,6 +842,42 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        ImGui::Begin("Draw stats");
+        if (ImGui::Checkbox("Sort meshes by material", &programState->sortByMaterial))
+            programState->sceneQueue.sortByMaterial = programState->sortByMaterial;
+        // counted over every pass of this frame, shadow maps included
+        const Model::DrawStats &stats = Model::GetDrawStats();
+        ImGui::Text("Mesh draws: %zu", stats.draws);
+        // state changes of the sorted render queues, over every pass as well
+        const RenderQueue::Stats &queueStats = RenderQueue::GetStats();
+        ImGui::Text("Queued items: %zu", queueStats.items);
+        ImGui::Text("Material binds: %zu", queueStats.materialBinds);
+        ImGui::Text("Material binds avoided: %zu", queueStats.materialBindsAvoided);
+        ImGui::Text("Program switches: %zu", queueStats.programSwitches);
+        ImGui::Text("Texture binds avoided: %zu", queueStats.textureBindsAvoided);
+        ImGui::Text("Triangles: %zu", stats.triangles);
+        ImGui::Text("Draws per LOD: %zu / %zu / %zu / %zu", stats.lodDraws[0], stats.lodDraws[1], stats.lodDraws[2], stats.lodDraws[3]);
+        // uniforms still set by name; a handle resolved up front avoids the lookup
+        Shader::UniformStats uniformStats = Shader::GetUniformStats();
+        ImGui::Text("Uniform name lookups: %zu (%zu unknown)", uniformStats.nameLookups, uniformStats.unknownNames);
+        ImGui::Text("Uniform uploads: %zu (%zu redundant skipped)", uniformStats.uploads, uniformStats.redundant);
+        // bytes sent this frame; the totals count frames since startup, a block is skipped when nothing in it changed
+        ImGui::Text("Camera block: %zu bytes, %zu uploads, %zu skipped", programState->cameraBuffer.LastUploadBytes(),
+                    programState->cameraBuffer.Uploads(), programState->cameraBuffer.Skipped());
+        ImGui::Text("Lights block: %zu bytes, %zu uploads, %zu skipped", programState->lightsBuffer.LastUploadBytes(),
+                    programState->lightsBuffer.Uploads(), programState->lightsBuffer.Skipped());
+        // gl state calls made through GLState this frame, and those it dropped because nothing would have changed
+        const GLState::Stats &glStats = GLState::GetStats();
+        ImGui::Text("GL program binds: %zu issued, %zu skipped", glStats.programs.issued, glStats.programs.skipped);
+        ImGui::Text("GL VAO binds: %zu issued, %zu skipped", glStats.vertexArrays.issued, glStats.vertexArrays.skipped);
+        ImGui::Text("GL texture binds: %zu issued, %zu skipped", glStats.textures.issued, glStats.textures.skipped);
+        ImGui::Text("GL blend/depth/cull: %zu issued, %zu skipped", glStats.fixedFunction.issued, glStats.fixedFunction.skipped);
+        ImGui::DragFloat("LOD pixel error", &programState->lodPixelError, 0.1f, 0.0f, 16.0f);
+        ImGui::DragFloat("Shadow LOD pixel error", &programState->shadowLodPixelError, 0.1f, 0.0f, 32.0f);
+        ImGui::End();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -737,45 +899,20 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 }
 unsigned int loadTexture(char const * path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
+    // only used for color maps, which are sRGB encoded
+    MipSettings mips;
+    mips.srgb = true;
+    KtxTexture texture;
+    if (!TextureLoader::Load(path, true, texture, mips))
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
+    return TextureFromKtx(texture, TextureLoader::SourceComponents(texture) == 4 ? GL_CLAMP_TO_EDGE : GL_REPEAT);
 }
 unsigned int loadCubemap(vector<std::string> faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLState::BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++)